@@ -0,0 +1,133 @@
+; Author: Sarker Nadir Afridi Azmi
+; Atomic primitives for tasks. Tasks run unprivileged, so they can not mask interrupts
+; to protect shared data. LDREX/STREX are used instead: STREX only stores if nothing
+; touched the word since the LDREX, otherwise the sequence is retried.
+; Taking an exception clears the exclusive monitor, so an ISR or a context switch in the
+; middle of a sequence always forces a retry.
+
+	.def atomicExchange
+	.def atomicFetchAdd
+	.def atomicCompareExchange
+	.def atomicSetBits
+	.def atomicClearBits
+	.def atomicFlagSet
+	.def atomicFlagClear
+	.def atomicFlagTest
+	.def dataMemoryBarrier
+
+.thumb
+
+; uint32_t atomicExchange(volatile uint32_t* address, uint32_t value)
+; Stores value and returns what was stored before
+atomicExchange:
+	DMB
+exchangeRetry:
+	LDREX R2, [R0]
+	STREX R3, R1, [R0]
+	CMP R3, #0
+	BNE exchangeRetry
+	DMB
+	MOV R0, R2
+	BX LR
+
+; uint32_t atomicFetchAdd(volatile uint32_t* address, uint32_t value)
+; Adds value and returns what was stored before. Pass a negative value to subtract.
+atomicFetchAdd:
+	DMB
+fetchAddRetry:
+	LDREX R2, [R0]
+	ADD R3, R2, R1
+	STREX R12, R3, [R0]
+	CMP R12, #0
+	BNE fetchAddRetry
+	DMB
+	MOV R0, R2
+	BX LR
+
+; bool atomicCompareExchange(volatile uint32_t* address, uint32_t expected, uint32_t desired)
+; Stores desired only if the word still holds expected. Returns true if it did.
+atomicCompareExchange:
+	DMB
+compareExchangeRetry:
+	LDREX R3, [R0]
+	CMP R3, R1
+	BNE compareExchangeFail
+	STREX R12, R2, [R0]
+	CMP R12, #0
+	BNE compareExchangeRetry
+	DMB
+	MOV R0, #1
+	BX LR
+compareExchangeFail:
+	CLREX
+	DMB
+	MOV R0, #0
+	BX LR
+
+; uint32_t atomicSetBits(volatile uint32_t* address, uint32_t bits)
+; ORs bits into the word and returns what was stored before
+atomicSetBits:
+	DMB
+setBitsRetry:
+	LDREX R2, [R0]
+	ORR R3, R2, R1
+	STREX R12, R3, [R0]
+	CMP R12, #0
+	BNE setBitsRetry
+	DMB
+	MOV R0, R2
+	BX LR
+
+; uint32_t atomicClearBits(volatile uint32_t* address, uint32_t bits)
+; Clears bits in the word and returns what was stored before
+atomicClearBits:
+	DMB
+clearBitsRetry:
+	LDREX R2, [R0]
+	BIC R3, R2, R1
+	STREX R12, R3, [R0]
+	CMP R12, #0
+	BNE clearBitsRetry
+	DMB
+	MOV R0, R2
+	BX LR
+
+; The bit-band alias of SRAM maps every bit of 0x20000000-0x200FFFFF to its own word
+; at 0x22000000 + offset * 32 + bit * 4. Writing the alias changes only that bit, in a
+; single bus transaction, so no retry loop is needed.
+; Leaves the alias address of bit R1 of the word at R0 in R0
+bitBandAlias:
+	SUB R0, R0, #0x20000000
+	LSL R0, R0, #5
+	ADD R0, R0, R1, LSL #2
+	ADD R0, R0, #0x22000000
+	BX LR
+
+; void atomicFlagSet(volatile uint32_t* address, uint8_t bit)
+atomicFlagSet:
+	PUSH {LR}
+	BL bitBandAlias
+	MOV R1, #1
+	STR R1, [R0]
+	POP {PC}
+
+; void atomicFlagClear(volatile uint32_t* address, uint8_t bit)
+atomicFlagClear:
+	PUSH {LR}
+	BL bitBandAlias
+	MOV R1, #0
+	STR R1, [R0]
+	POP {PC}
+
+; bool atomicFlagTest(volatile uint32_t* address, uint8_t bit)
+atomicFlagTest:
+	PUSH {LR}
+	BL bitBandAlias
+	LDR R0, [R0]
+	POP {PC}
+
+; void dataMemoryBarrier()
+; All memory accesses before the barrier complete before any access after it
+dataMemoryBarrier:
+	DMB
+	BX LR
@@ -0,0 +1,46 @@
+/*
+ * atomic.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#ifndef INCLUDE_ATOMIC_H_
+#define INCLUDE_ATOMIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Implemented in atomic.s
+//
+// Memory ordering:
+// - The read-modify-write functions (exchange, fetch-add, compare-exchange, set and clear
+//   bits) have a DMB before and after them. No memory access is moved across them in
+//   either direction, so they can be used to both publish and acquire data.
+//   compareExchange has the same barriers when it fails.
+// - The flag functions use the bit-band alias and have no barriers. Setting or clearing
+//   a flag is atomic, but it does not order the accesses around it. Call
+//   dataMemoryBarrier() first if the flag publishes other data.
+// - Plain reads and writes of aligned 32-bit words are atomic, but they are not ordered.
+//
+// The flag functions only work on SRAM, between 0x20000000 and 0x200FFFFF. The MPU checks
+// the alias address, not the word it maps to, so only use them on memory the task owns.
+
+// Stores value and returns what was stored before
+extern uint32_t atomicExchange(volatile uint32_t* address, uint32_t value);
+// Adds value and returns what was stored before
+extern uint32_t atomicFetchAdd(volatile uint32_t* address, uint32_t value);
+// Stores desired only if the word still holds expected. Returns true if it did.
+extern bool atomicCompareExchange(volatile uint32_t* address, uint32_t expected, uint32_t desired);
+// ORs bits into the word and returns what was stored before
+extern uint32_t atomicSetBits(volatile uint32_t* address, uint32_t bits);
+// Clears bits in the word and returns what was stored before
+extern uint32_t atomicClearBits(volatile uint32_t* address, uint32_t bits);
+// Sets, clears or reads a single bit through the bit-band alias
+extern void atomicFlagSet(volatile uint32_t* address, uint8_t bit);
+extern void atomicFlagClear(volatile uint32_t* address, uint8_t bit);
+extern bool atomicFlagTest(volatile uint32_t* address, uint8_t bit);
+// All memory accesses before the barrier complete before any access after it
+extern void dataMemoryBarrier();
+
+#endif /* INCLUDE_ATOMIC_H_ */
@@ -0,0 +1,28 @@
+/*
+ * benchmark.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#ifndef INCLUDE_BENCHMARK_H_
+#define INCLUDE_BENCHMARK_H_
+
+#include <stdbool.h>
+
+// Uncomment to run the benchmark tasks instead of the regular tasks. The results are
+// printed on UART0 in Timer 2 clocks (40 MHz).
+// #define BENCHMARK
+
+#define BENCHMARK_ITERATIONS    1000
+
+// Reader scaling runs up to BENCHMARK_READERS readers, each doing this many reads
+#define BENCHMARK_READERS               4
+#define BENCHMARK_READER_ITERATIONS     100
+
+// Number of slots in the queues being compared, must be a power of 2
+#define BENCHMARK_QUEUE_SIZE    16
+
+bool createBenchmarkThreads();
+
+#endif /* INCLUDE_BENCHMARK_H_ */
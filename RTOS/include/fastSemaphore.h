@@ -0,0 +1,30 @@
+/*
+ * fastSemaphore.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#ifndef INCLUDE_FASTSEMAPHORE_H_
+#define INCLUDE_FASTSEMAPHORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Semaphore whose count lives in task memory and is updated with LDREX/STREX.
+// While there is no contention, waiting and posting never leave the task. The kernel
+// semaphore is only used to block a task that finds the count used up and to wake it
+// up again, so it is created with a count of 0.
+// The struct has to live in memory that all the tasks using it can access.
+typedef struct _fastSemaphore
+{
+    volatile int32_t count;        // free units if positive, minus the number of waiting tasks if negative
+    int8_t semaphore;              // kernel semaphore the waiting tasks block on
+} fastSemaphore;
+
+void fastSemaphoreInit(fastSemaphore* fs, int32_t count, int8_t semaphore);
+void fastWait(fastSemaphore* fs);
+bool fastTryWait(fastSemaphore* fs);
+void fastPost(fastSemaphore* fs);
+
+#endif /* INCLUDE_FASTSEMAPHORE_H_ */
@@ -18,20 +18,143 @@
 // function pointer
 typedef void (*_fn)();
 
+// Tasks blocked on a kernel object are linked together through their tcb entries,
+// so a waiter can be unlinked from anywhere in the queue without shifting the others
+typedef struct _waitQueue
+{
+    int8_t head;                   // index of the first waiting task, -1 if empty
+    int8_t tail;                   // index of the last waiting task, -1 if empty
+    uint8_t size;
+} waitQueue;
+
 // semaphore
-#define MAX_SEMAPHORES 5
-#define MAX_QUEUE_SIZE 5
+// Semaphores are created at run time and referred to by the index of their slot (handle).
+// Tasks that did not create a semaphore get its handle by looking up its name.
+#define MAX_SEMAPHORES 16
 
 #define MAX_SEM_NAME                16
 #define MAX_SEM_WAIT_QUEUE_SIZE     5
 
 typedef struct _semaphore
 {
+    bool inUse;
     uint16_t count;
-    uint16_t queueSize;
-    uint32_t processQueue[MAX_QUEUE_SIZE]; // store task index here
+    waitQueue waiting;             // tasks blocked on the semaphore, in the order they arrived
+    char name[MAX_SEM_NAME];
 } semaphore;
 
+// reader-writer locks
+// Any number of readers can hold the lock at the same time, a writer holds it alone.
+// Writers are preferred: once a writer is waiting, new readers queue up behind it.
+// Both wait queues are kept in priority order. Read locks do not nest, a reader that
+// locks again keeps the hold it has.
+#define MAX_RWLOCKS 4
+
+typedef struct _rwLock
+{
+    bool inUse;
+    uint16_t readers;              // bit n set while task n holds the lock for reading
+    int8_t writer;                 // task holding the lock for writing, -1 if none
+    waitQueue readersWaiting;
+    waitQueue writersWaiting;
+    char name[MAX_SEM_NAME];
+} rwLock;
+
+// mutexes and condition variables
+// A mutex remembers the task that holds it. Only that task can unlock it, and it can lock
+// it again without blocking as long as every lock is matched by an unlock.
+// Signalling a condition moves the waiter straight onto the mutex queue, so it only runs
+// once it can actually get the mutex.
+#define MAX_MUTEXES     4
+#define MAX_CONDITIONS  4
+
+// Status returned by the mutex and condition calls
+#define MUTEX_OK                0
+#define MUTEX_INVALID           1   // the handle is not a mutex or condition
+#define MUTEX_NOT_OWNER         2   // the caller does not hold the mutex
+#define MUTEX_RECURSION_LIMIT   3   // the caller already holds the mutex too many times
+
+typedef struct _mutex
+{
+    bool inUse;
+    int8_t owner;                  // task holding the mutex, -1 if none
+    uint8_t depth;                 // number of times the owner has locked it
+    waitQueue waiting;             // kept in priority order
+    char name[MAX_SEM_NAME];
+} mutex;
+
+typedef struct _condition
+{
+    bool inUse;
+    waitQueue waiting;             // kept in priority order
+    char name[MAX_SEM_NAME];
+} condition;
+
+// pipes
+// A pipe carries a stream of bytes between tasks through storage owned by the kernel.
+// A reader sleeps until the trigger level is reached, or as many bytes as it asked for if
+// that is fewer, so the writer can hand over data in small pieces without waking the
+// reader for each of them. A writer sleeps while the pipe is full.
+#define MAX_PIPES   2
+#define PIPE_SIZE   128                 // must be a power of 2
+
+typedef struct _pipe
+{
+    bool inUse;
+    uint8_t data[PIPE_SIZE];
+    uint16_t head;                 // next byte to read
+    uint16_t tail;                 // next byte to write
+    uint16_t count;                // bytes in the pipe
+    uint16_t trigger;              // bytes needed to wake up a reader
+    waitQueue readersWaiting;
+    waitQueue writersWaiting;
+    char name[MAX_SEM_NAME];
+} pipe;
+
+// barriers
+// Tasks arriving at a barrier block until the last of its parties arrives. That arrival
+// releases all of them at once and the scheduler decides who runs next only after that.
+#define MAX_BARRIERS 2
+
+// Returned by barrierWait() to exactly one of the tasks released, the others get 0
+#define BARRIER_SERIAL      1
+
+typedef struct _barrier
+{
+    bool inUse;
+    uint8_t parties;               // tasks that have to arrive to release the barrier
+    uint8_t arrived;               // tasks waiting at the barrier
+    waitQueue waiting;
+    char name[MAX_SEM_NAME];
+} barrier;
+
+// ISRs can not make syscalls, so the FromIsr functions only queue the request.
+// The kernel applies queued requests in PendSV, or on the next systick when preemption is off.
+#define MAX_DEFERRED_REQUESTS 16        // must be a power of 2
+
+// Status returned by timedWait()
+#define WAIT_TIMEOUT    0
+#define WAIT_ACQUIRED   1
+
+// Timeout for pipeRead() and selectWait() that never runs out
+#define WAIT_FOREVER    0xFFFFFFFF
+
+// selectWait() blocks on a set of objects until one of them becomes ready. It only reports
+// which one is ready, the task then takes it with the usual call, like wait() or pipeRead().
+#define MAX_SELECT_ITEMS    8
+
+// Kinds of object selectWait() can wait on
+#define SELECT_SEMAPHORE    0       // ready when the count is not 0
+#define SELECT_PIPE         1       // ready when the pipe holds its trigger level
+#define SELECT_EVENT        2       // ready when any of the flags is set
+
+typedef struct _selectItem
+{
+    uint8_t type;                  // see SELECT_ values above
+    int8_t handle;                 // semaphore or pipe handle, or event group number
+    uint32_t flags;                // event flags to wait for, only used for SELECT_EVENT
+} selectItem;
+
 // Custom struct for user space semaphore info
 struct _semaphoreInformation
 {
@@ -41,10 +164,19 @@ struct _semaphoreInformation
     uint32_t waitQueue[MAX_SEM_WAIT_QUEUE_SIZE];
 };
 
-#define keyPressed 1
-#define keyReleased 2
-#define flashReq 3
-#define resource 4
+// event flag groups
+#define MAX_EVENT_GROUPS 4
+
+// Options for waitEventFlags(), can be OR'd together
+#define EVENT_WAIT_ANY          0x00   // wake up when any of the requested flags is set
+#define EVENT_WAIT_ALL          0x01   // wake up only when all of the requested flags are set
+#define EVENT_CLEAR_ON_EXIT     0x02   // clear the requested flags once the wait is satisfied
+
+typedef struct _eventGroup
+{
+    uint32_t flags;
+    waitQueue waiting;
+} eventGroup;
 
 // task
 #define STATE_INVALID    0 // no task
@@ -52,12 +184,38 @@ struct _semaphoreInformation
 #define STATE_READY      2 // has run, can resume at any time
 #define STATE_DELAYED    3 // has run, but now awaiting timer
 #define STATE_BLOCKED    4 // has run, but now blocked by semaphore
-#define STATE_KILLED     5
+#define STATE_KILLED     5 // no stack, the slot is kept so that the task can be resumed
+
+// What a task in STATE_BLOCKED is waiting on
+#define BLOCKED_ON_NONE         0
+#define BLOCKED_ON_SEMAPHORE    1
+#define BLOCKED_ON_BUFFER       2
+#define BLOCKED_ON_EVENT        3
+#define BLOCKED_ON_NOTIFY       4
+#define BLOCKED_ON_RWLOCK       5
+#define BLOCKED_ON_MUTEX        6
+#define BLOCKED_ON_CONDITION    7
+#define BLOCKED_ON_PIPE         8
+#define BLOCKED_ON_SELECT       9
+#define BLOCKED_ON_BARRIER      10
+#define BLOCKED_ON_POOL         11
 
 #define MAX_TASKS 12       // maximum number of valid tasks
 
-// REQUIRED: add store and management for the memory used by the thread stacks
-//           thread stacks must start on 1 kiB boundaries so mpu can work correctly
+// Size in bytes of the guard at the bottom of every stack. Tasks can not access it, so a
+// task that runs off the end of its stack faults right away instead of overwriting
+// whatever is below. The guard comes out of the stack reservation.
+// Must be a power of 2 between 32 and 1024, or 0 to turn the guard off.
+#define STACK_GUARD_SIZE    64
+
+// Thread stacks are made of whole 1KiB blocks taken from the SRAM block bitmap, so they
+// start on 1KiB boundaries and line up with the MPU subregions. A killed thread gives its
+// blocks back and gets new ones when it is restarted.
+// Stacks of up to SMALL_STACK_MAX bytes are rounded up to a power of 2 instead and share
+// a block with other small stacks. The MPU region 6 is pointed at the running task's
+// small stack, since a subregion is too big to cover it.
+#define SMALL_STACK_MIN     256
+#define SMALL_STACK_MAX     512
 
 struct _tcb
 {
@@ -65,14 +223,130 @@ struct _tcb
     void *pid;                     // used to uniquely identify thread
     void *spInit;                  // original top of stack
     void *sp;                      // current stack pointer
+    void *stackBase;               // lowest address of the stack, 0 while the task has no stack
+    uint32_t stackBytes;           // size of the stack, so it can be allocated again on restart
     int8_t priority;               // 0=highest to 15=lowest
     uint32_t ticks;                // ticks until sleep complete
     uint32_t srd;                  // MPU subregion disable bits
     uint32_t time;                 // Amount of the time the task spent running
     char name[16];                 // name of task used in ps command
-    void *semaphore;               // pointer to the semaphore that is blocking the thread
+    uint8_t blockedOn;             // see BLOCKED_ON_ values above
+    waitQueue *queue;              // wait queue the task is linked into while blocked
+    int8_t prev;                   // previous task in the wait queue, -1 if first
+    int8_t next;                   // next task in the wait queue, -1 if last
+    bool timedWait;                // ticks counts down to a timeout while blocked
+    uint32_t eventFlags;           // event flags the task is waiting for
+    uint8_t eventOptions;          // see EVENT_ options above
+    uint32_t notifyValue;          // notification word written directly by other tasks
+    bool notifyClear;              // clear the whole word instead of decrementing it on take
+    int8_t mutex;                  // mutex the task gets back after a condition wait
+    uint8_t mutexDepth;            // lock depth the task gets the mutex back with
+    uint8_t *ioBuffer;             // where a task blocked on a pipe reads to or writes from
+    uint32_t ioBytes;              // bytes left to read or write
+    uint32_t ioDone;               // bytes written so far
+    const selectItem *selectItems; // objects a task blocked in selectWait() is waiting on
+    uint8_t selectCount;
 } tcb[MAX_TASKS];
 
+// Buffers are whole 1KiB blocks of SRAM that are handed between tasks by moving
+// their MPU subregions from one task's srd mask to another's, so no data is copied
+#define MAX_BUFFERS 4
+
+typedef struct _buffer
+{
+    void *base;                    // 1KiB aligned start of the buffer, 0 if unused
+    uint32_t size;                 // size in bytes, always a multiple of 1KiB
+    uint32_t srd;                  // MPU subregion bits covered by the buffer
+    int8_t owner;                  // index of the task that currently has access
+    bool pending;                  // handed to the owner but not yet received
+} buffer;
+
+// Shared memory is a named run of 1KiB blocks mapped into the srd mask of every task that
+// was made a member with shareMemory(). Members read and write it directly, everyone
+// else still faults on it. A member gets the address by name with shmOpen().
+#define MAX_SHARED_MEMORY 4
+
+typedef struct _sharedMemory
+{
+    bool inUse;
+    void *base;                    // start of the memory
+    uint32_t size;                 // size in bytes, always a multiple of 1KiB
+    uint32_t srd;                  // MPU subregion bits covered by the memory
+    uint16_t members;              // bit n is set if task n can access the memory
+    char name[MAX_SEM_NAME];
+} sharedMemory;
+
+// Memory handed to tasks by allocateMemory(). Allocations are whole 1KiB blocks, so the
+// owner gets access by setting their subregions in its srd mask, and nobody else can touch them.
+#define MAX_ALLOCATIONS 8
+
+typedef struct _allocation
+{
+    void *base;                    // start of the allocation, 0 if the slot is unused
+    uint32_t size;                 // size in bytes, always a multiple of 1KiB
+    int8_t owner;                  // index of the task the memory belongs to
+} allocation;
+
+// Pools of fixed size blocks. Blocks are meant to be passed between tasks, so pool memory
+// is open to every task. Which blocks are free is only kept in the kernel's bitmap,
+// never in the blocks themselves, so a task writing to a free block can not corrupt it.
+#define MAX_POOLS 4
+#define MAX_POOL_BLOCKS 128
+
+typedef struct _pool
+{
+    bool inUse;
+    void *base;                    // start of the pool memory, whole 1KiB blocks
+    uint16_t blockSize;            // bytes per block, a multiple of 4
+    uint16_t blockCount;
+    uint16_t used;                 // blocks currently allocated
+    uint16_t highWater;            // most blocks ever allocated at the same time
+    uint32_t allocated[MAX_POOL_BLOCKS / 32]; // bit n set while block n is allocated
+    waitQueue waiting;             // tasks waiting for a block, in priority order
+    char name[MAX_SEM_NAME];
+} pool;
+
+// User space struct to store pool usage
+struct _poolInformation
+{
+    char name[MAX_SEM_NAME];
+    uint16_t blockSize;
+    uint16_t blockCount;
+    uint16_t used;
+    uint16_t highWater;
+    uint8_t waiting;
+};
+
+// User space struct to store heap usage
+struct _heapInformation
+{
+    uint8_t allocations;           // number of allocations in use
+    uint32_t allocatedBytes;       // bytes handed out by allocateMemory()
+    uint32_t freeBytes;            // SRAM not used by the kernel, stacks, buffers or allocations
+    uint32_t largestFreeBytes;     // largest allocation that can still be made
+};
+
+// Characters used in the SRAM map of the mem command, one per 1KiB block
+#define MEM_MAP_KERNEL          'K'
+#define MEM_MAP_STACK           'S'
+#define MEM_MAP_SMALL_STACKS    's'
+#define MEM_MAP_BUFFER          'B'
+#define MEM_MAP_POOL            'P'
+#define MEM_MAP_HEAP            'H'
+#define MEM_MAP_SHARED          'M'
+#define MEM_MAP_FREE            '.'
+
+// User space struct to store the SRAM layout and usage
+struct _memoryInformation
+{
+    uint32_t sramBase;
+    uint32_t kernelDataBytes;      // .data, .bss and .sysmem
+    uint32_t kernelStackBytes;
+    uint32_t arenaBytes;           // SRAM tasks get their memory from
+    uint32_t freeBytes;            // free blocks of the arena
+    char map[33];                  // one MEM_MAP_ character per block, null terminated
+};
+
 // User space struct to store pid info
 struct _taskInfo
 {
@@ -80,6 +354,8 @@ struct _taskInfo
     uint32_t pid;                  // used to uniquely identify thread
     char name[16];                 // name of task used in ps command
     uint32_t time;                 // CPU usage time
+    uint32_t stackBytes;           // stack reserved for the task
+    uint32_t stackUsed;            // most of the stack the task has used since it was started
 };
 
 // Scheduler
@@ -94,14 +370,21 @@ typedef enum _schedulerId
 #define REGION_3            0x00000003
 #define REGION_4            0x00000004
 #define REGION_5            0x00000005
-#define REGION_6            0x00000006      // Highest priority
-
-#define SRAM_REGION_0       0x20000000
-#define SRAM_REGION_1       0x20002000
-#define SRAM_REGION_2       0x20004000
-#define SRAM_REGION_3       0x20006000
+#define REGION_6            0x00000006
+#define REGION_7            0x00000007      // Highest priority
 
 #define SIZE_8KIB           0x0000000C      // SIZE = 12 in 2^(SIZE + 1) to obtain a 8KiB size
+#define SRAM_REGION_SIZE    0x00002000
+
+// SRAM layout, defined in tm4c123gh6pm.cmd. Only the addresses of these are meaningful.
+extern uint32_t __sram_start;
+extern uint32_t __sram_end;
+extern uint32_t __kernel_data_start;
+extern uint32_t __kernel_data_end;
+extern uint32_t __kernel_stack_start;
+extern uint32_t __kernel_stack_end;
+extern uint32_t __task_arena_start;
+extern uint32_t __task_arena_end;
 
 #define DEBUG
 
@@ -119,6 +402,8 @@ void enableFlashRule();
 void enableSRAMRule(uint32_t startAddress, uint32_t size, uint32_t region);
 void sRAMSubregionDisable(uint8_t region, uint32_t subregion);
 void sRAMSubregionEnable(uint8_t region, uint32_t subregion);
+void setStackGuard(uint32_t stackBase);
+void setSmallStackRegion(uint32_t stackBase, uint32_t stackBytes);
 void enableMPU();
 
 void initRtos();
@@ -127,13 +412,38 @@ int priorityRtosScheduler();
 void setSchedulerMode(schedulerId schedId);
 void initTaskNextPriorities();
 bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes);
-void restartThread(_fn fn);
+bool restartThread(_fn fn);
 void destroyThread(_fn fn);
 void setThreadPriority(_fn fn, uint8_t priority);
-void getIpcsData(struct _semaphoreInformation* si);
+void getIpcsData(struct _semaphoreInformation* si, uint8_t* siCount);
 void getPsInfo(struct _taskInfo* ti, uint8_t* tiCount);
-bool createSemaphore(uint8_t semaphore, uint8_t count);
+void getHeapInfo(struct _heapInformation* hi);
+void getMemoryInfo(struct _memoryInformation* mi);
+void getPoolsInfo(struct _poolInformation* pi, uint8_t* piCount);
+int8_t createPool(const char name[], uint16_t blockSize, uint16_t blockCount);
+int8_t findPool(const char name[]);
+int8_t createSemaphore(const char name[], uint8_t count);
+int8_t findSemaphore(const char name[]);
+bool deleteSemaphore(int8_t semaphore);
+bool createBuffer(_fn fn, uint32_t bytes);
+bool createSharedMemory(const char name[], uint32_t bytes);
+int8_t findSharedMemory(const char name[]);
+bool shareMemory(const char name[], _fn fn);
+bool createEventGroup(uint8_t group);
+int8_t createRwLock(const char name[]);
+int8_t findRwLock(const char name[]);
+int8_t createBarrier(const char name[], uint8_t parties);
+int8_t findBarrier(const char name[]);
+int8_t createPipe(const char name[], uint16_t trigger);
+int8_t findPipe(const char name[]);
+int8_t createMutex(const char name[]);
+int8_t findMutex(const char name[]);
+int8_t createCondition(const char name[]);
+int8_t findCondition(const char name[]);
 void startRtos();
+bool postFromIsr(int8_t semaphore);
+bool notifyGiveFromIsr(uint32_t pid);
+bool notifySetBitsFromIsr(uint32_t pid, uint32_t bits);
 
 #ifdef DEBUG
 
@@ -0,0 +1,42 @@
+/*
+ * mpmcQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#ifndef INCLUDE_MPMCQUEUE_H_
+#define INCLUDE_MPMCQUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fastSemaphore.h"
+
+// Bounded lock-free multiple-producer/multiple-consumer queue.
+// Every cell has a sequence number that tells whether it is free to write for a given
+// position or holds a value ready to read. Producers and consumers claim a position with
+// a compare-exchange, so they never block each other through the kernel.
+// A full queue makes push fail. A consumer that finds the queue empty blocks on the
+// fast semaphore counting the values, which is the only time the kernel gets involved.
+// The struct and the cells have to live in memory that all the tasks using it can access.
+typedef struct _mpmcCell
+{
+    volatile uint32_t sequence;
+    uint32_t value;
+} mpmcCell;
+
+typedef struct _mpmcQueue
+{
+    volatile uint32_t enqueuePosition;
+    volatile uint32_t dequeuePosition;
+    uint32_t mask;                 // number of cells - 1, the number of cells is a power of 2
+    mpmcCell* cells;
+    fastSemaphore values;          // values in the queue, consumers block on it when empty
+} mpmcQueue;
+
+bool mpmcQueueInit(mpmcQueue* q, mpmcCell* cells, uint32_t size, int8_t semaphore);
+bool mpmcQueuePush(mpmcQueue* q, uint32_t value);
+bool mpmcQueueTryPop(mpmcQueue* q, uint32_t* value);
+uint32_t mpmcQueuePop(mpmcQueue* q);
+
+#endif /* INCLUDE_MPMCQUEUE_H_ */
@@ -18,6 +18,7 @@
 
 void initSysTick(uint32_t loadValue);
 void initTimer1();
+void initTimer2();
 void initLedPb();
 uint8_t readPbs();
 
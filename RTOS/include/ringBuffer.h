@@ -0,0 +1,35 @@
+/*
+ * ringBuffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#ifndef INCLUDE_RINGBUFFER_H_
+#define INCLUDE_RINGBUFFER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// The producer only ever writes head and the consumer only ever writes tail, so pushing
+// and popping never trap into the kernel. The kernel is only involved when the consumer
+// finds the buffer empty and has to block on the semaphore.
+// The struct and the data have to live in memory that both sides can access.
+typedef struct _ringBuffer
+{
+    volatile uint32_t head;        // next slot to write, only written by the producer
+    volatile uint32_t tail;        // next slot to read, only written by the consumer
+    volatile uint32_t waiting;     // set while the consumer is about to block or blocked
+    uint32_t mask;                 // number of slots - 1, the number of slots is a power of 2
+    uint32_t* data;
+    int8_t semaphore;              // semaphore the consumer blocks on, created with a count of 0
+} ringBuffer;
+
+bool ringBufferInit(ringBuffer* rb, uint32_t* data, uint32_t size, int8_t semaphore);
+bool ringBufferPush(ringBuffer* rb, uint32_t value);
+bool ringBufferTryPop(ringBuffer* rb, uint32_t* value);
+uint32_t ringBufferPop(ringBuffer* rb);
+uint32_t ringBufferCount(ringBuffer* rb);
+
+#endif /* INCLUDE_RINGBUFFER_H_ */
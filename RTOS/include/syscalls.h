@@ -12,21 +12,73 @@
 #include <stdbool.h>
 #include "kernel.h"
 
-#define MAX_SEM_INFO_SIZE           5
+#define MAX_SEM_INFO_SIZE           MAX_SEMAPHORES
 #define MAX_TASKS_TASK_INFO         12
 
 typedef struct _semaphoreInformation semaphoreInfo;
 typedef struct _taskInfo taskInfo;
+typedef struct _heapInformation heapInfo;
+typedef struct _poolInformation poolInfo;
+typedef struct _memoryInformation memoryInfo;
 
 void yield();
 void sleep(uint32_t tick);
 void wait(int8_t semaphore);
 void post(int8_t semaphore);
+// Waits on a semaphore for at most ticks ms, returns WAIT_ACQUIRED or WAIT_TIMEOUT
+uint8_t timedWait(int8_t semaphore, uint32_t ticks);
+// Creates a named semaphore and returns its handle, -1 on failure
+int8_t semCreate(const char name[], uint8_t count);
+// Returns the handle of the semaphore with matching name, -1 if there is none
+int8_t semOpen(const char name[]);
+bool semDelete(int8_t semaphore);
+// Reader-writer locks, created with createRwLock() before the RTOS starts
+int8_t rwLockOpen(const char name[]);
+bool readLock(int8_t lock);
+bool readUnlock(int8_t lock);
+// Returns false instead of deadlocking if the caller already reads or writes the lock
+bool writeLock(int8_t lock);
+bool writeUnlock(int8_t lock);
+// Pipes, created with createPipe() before the RTOS starts
+int8_t pipeOpen(const char name[]);
+uint32_t pipeWrite(int8_t pipe, const void* data, uint32_t bytes);
+// Readers are served in the order they arrived. One that times out before it is next in
+// line returns 0.
+uint32_t pipeRead(int8_t pipe, void* data, uint32_t bytes, uint32_t ticks);
+// Memory only the calling task can access, in whole 1KiB blocks
+void* allocateMemory(uint32_t bytes);
+bool freeMemory(void* p);
+void heapStats(heapInfo* hi);
+void memInfo(memoryInfo* mi);
+// Returns the address of the shared memory with matching name, or 0 if it does not
+// exist or was not shared with the calling task
+void* shmOpen(const char name[]);
+// Fixed size block pools, created with createPool() before the RTOS starts
+int8_t poolOpen(const char name[]);
+void* poolAlloc(int8_t pool, uint32_t ticks);
+// Returns false if the block is not an allocated block of the pool
+bool poolFree(int8_t pool, void* block);
+void pools(poolInfo* pi, uint8_t* piCount);
+// Barriers, created with createBarrier() before the RTOS starts
+int8_t barrierOpen(const char name[]);
+int8_t barrierWait(int8_t barrier);
+// Blocks until one of the objects is ready and returns its index in items, or -1 if
+// ticks ms pass first. Pass 0 to only check or WAIT_FOREVER to not time out.
+int8_t selectWait(const selectItem items[], uint8_t count, uint32_t ticks);
+// Mutexes and conditions, created with createMutex() and createCondition() before the
+// RTOS starts. All but the open calls return one of the MUTEX_ status values.
+int8_t mutexOpen(const char name[]);
+uint8_t mutexLock(int8_t mutex);
+uint8_t mutexUnlock(int8_t mutex);
+int8_t condOpen(const char name[]);
+uint8_t condWait(int8_t condition, int8_t mutex);
+uint8_t condSignal(int8_t condition);
+uint8_t condBroadcast(int8_t condition);
 void rebootSystem();
 // Displays the process (thread) information
 void ps(taskInfo* ti, uint8_t* tiCount);
 // Displays the inter-process (thread) communication state
-void ipcs(semaphoreInfo* semInfo);
+void ipcs(semaphoreInfo* semInfo, uint8_t* semInfoCount);
 // Kills the process (thread) with matching PID
 void kill(uint32_t pid);
 // Turns priority inheritance on or off
@@ -38,5 +90,22 @@ void sched(bool prioOn);
 // Displays the PID of the process (thread)
 void pidof(uint32_t* pid, char name[]);
 void resume(const char* name);
+// Hands a buffer owned by the calling task over to the task with matching PID
+bool sendBuffer(uint32_t pid, void* buffer);
+// Blocks until a buffer is handed to the calling task and returns its address
+void* receiveBuffer(uint32_t* size);
+// The event flag calls return 0 if the group is not valid
+// Sets flags in an event group and wakes every task whose wait is now satisfied
+uint32_t setEventFlags(uint8_t group, uint32_t flags);
+// Clears flags in an event group and returns the flags as they were before
+uint32_t clearEventFlags(uint8_t group, uint32_t flags);
+// Blocks until any or all (see EVENT_ options) of the flags are set in the event group
+uint32_t waitEventFlags(uint8_t group, uint32_t flags, uint8_t options);
+// Direct-to-task notifications, pid is the task to notify
+bool notifyGive(uint32_t pid);
+bool notifySetBits(uint32_t pid, uint32_t bits);
+bool notifyOverwrite(uint32_t pid, uint32_t value);
+// Blocks until the notification word of the calling task is non-zero
+uint32_t notifyTake(bool clear);
 
 #endif /* INCLUDE_SYSCALLS_H_ */
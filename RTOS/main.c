@@ -8,6 +8,7 @@
 #include "uart0.h"
 #include "wait.h"
 #include "peripheral.h"
+#include "benchmark.h"
 
 // REQUIRED: correct these bitbanding references for the off-board LEDs
 #define BLUE_LED     (*((volatile uint32_t *)(0x42000000 + (0x400253FC-0x40000000)*32 + 2*4))) // on-board blue LED
@@ -108,6 +109,7 @@ void flash4Hz()
 
 void oneshot()
 {
+    int8_t flashReq = semOpen("flashReq");
     while(true)
     {
         wait(flashReq);
@@ -128,6 +130,7 @@ void partOfLengthyFn()
 void lengthyFn()
 {
     uint16_t i;
+    int8_t resource = semOpen("resource");
     while(true)
     {
         wait(resource);
@@ -143,6 +146,9 @@ void lengthyFn()
 void readKeys()
 {
     uint8_t buttons;
+    int8_t keyPressed = semOpen("keyPressed");
+    int8_t keyReleased = semOpen("keyReleased");
+    int8_t flashReq = semOpen("flashReq");
     while(true)
     {
         wait(keyReleased);
@@ -183,6 +189,8 @@ void readKeys()
 void debounce()
 {
     uint8_t count;
+    int8_t keyPressed = semOpen("keyPressed");
+    int8_t keyReleased = semOpen("keyReleased");
     while(true)
     {
         wait(keyPressed);
@@ -225,6 +233,7 @@ void errant()
 
 void important()
 {
+    int8_t resource = semOpen("resource");
     while(true)
     {
         wait(resource);
@@ -253,14 +262,19 @@ int main(void)
     GREEN_LED = 1;
     waitMicrosecond(250000);
 
+#ifdef BENCHMARK
+    // The benchmarks bring their own idle process and semaphores
+    ok = createBenchmarkThreads();
+#else
     // Initialize semaphores
-    createSemaphore(keyPressed, 1);
-    createSemaphore(keyReleased, 0);
-    createSemaphore(flashReq, 5);
-    createSemaphore(resource, 1);
+    // Tasks look the handles up by name with semOpen()
+    createSemaphore("keyPressed", 1);
+    createSemaphore("keyReleased", 0);
+    createSemaphore("flashReq", 5);
+    createSemaphore("resource", 1);
 
     // Add required idle process at lowest priority
-    ok = createThread(idle, "Idle", 7, 1024);
+    ok = createThread(idle, "Idle", 7, 512);
 
     // Add other processes
 
@@ -273,6 +287,7 @@ int main(void)
     ok &= createThread(uncooperative, "Uncoop", 6, 1024);
     ok &= createThread(errant, "Errant", 6, 1024);
     ok &= createThread(shell, "Shell", 6, 3000);
+#endif
 
     // Loads up the task indices from the tcb in order of priority
     initTaskNextPriorities();
@@ -0,0 +1,288 @@
+/*
+ * benchmark.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ *
+ *  Every benchmark runs the same number of iterations under the same scheduling pattern,
+ *  so the difference between two results is the cost of the primitives themselves.
+ *  The benchmark idle task only yields, so it does not add its own delay to a round trip.
+ */
+
+#include "tm4c123gh6pm.h"
+#include "kernel.h"
+#include "syscalls.h"
+#include "uart0.h"
+#include "utils.h"
+#include "peripheral.h"
+#include "fastSemaphore.h"
+#include "mpmcQueue.h"
+#include "benchmark.h"
+
+static void printResult(char* name, uint32_t clocks)
+{
+    printfString(24, name);
+    printfInteger("%u", 12, clocks / BENCHMARK_ITERATIONS);
+    putsUart0("clocks per round trip\n");
+}
+
+// Queue guarded the usual way, with one semaphore as a lock and one counting the values
+typedef struct _lockedQueue
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t data[BENCHMARK_QUEUE_SIZE];
+    int8_t lock;
+    int8_t values;
+} lockedQueue;
+
+static void lockedQueuePush(lockedQueue* q, uint32_t value)
+{
+    wait(q->lock);
+    q->data[q->head++ & (BENCHMARK_QUEUE_SIZE - 1)] = value;
+    post(q->lock);
+    post(q->values);
+}
+
+static uint32_t lockedQueuePop(lockedQueue* q)
+{
+    uint32_t value;
+    wait(q->values);
+    wait(q->lock);
+    value = q->data[q->tail++ & (BENCHMARK_QUEUE_SIZE - 1)];
+    post(q->lock);
+    return value;
+}
+
+void benchmarkIdle()
+{
+    while(true)
+        yield();
+}
+
+void benchmarkPong();
+void benchmarkReader1();
+void benchmarkReader2();
+void benchmarkReader3();
+void benchmarkReader4();
+
+// Values sent to the readers with notifyOverwrite() to pick how they guard the shared data
+#define READ_WITH_SEMAPHORE     1
+#define READ_WITH_RWLOCK        2
+
+static _fn readers[BENCHMARK_READERS] = {benchmarkReader1, benchmarkReader2, benchmarkReader3, benchmarkReader4};
+
+// Starts the first count readers and returns the clocks taken until all of them are done
+static uint32_t runReaders(uint8_t count, uint32_t mode)
+{
+    uint8_t i;
+    uint32_t done = 0;
+    uint32_t start = TIMER2_TAV_R;
+    for(i = 0; i < count; i++)
+        notifyOverwrite((uint32_t)readers[i], mode);
+    while(done < count)
+        done += notifyTake(true);
+    return TIMER2_TAV_R - start;
+}
+
+static void printReaderResult(char* name, uint8_t count, uint32_t clocks)
+{
+    printfString(24, name);
+    printfInteger("%u", 4, count);
+    // Timer 2 runs at 40 MHz, so clocks / 40000 is in milliseconds
+    printfInteger("%u", 12, (count * BENCHMARK_READER_ITERATIONS * 1000) / (clocks / 40000));
+    putsUart0("reads per second\n");
+}
+
+// Ping-pong between two tasks, first with a pair of semaphores and then with
+// direct-to-task notifications
+void benchmarkPing()
+{
+    uint16_t i;
+    uint32_t start;
+    uint32_t semaphoreClocks;
+    uint32_t notifyClocks;
+    int8_t benchPing = semOpen("benchPing");
+    int8_t benchPong = semOpen("benchPong");
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        post(benchPing);
+        wait(benchPong);
+    }
+    semaphoreClocks = TIMER2_TAV_R - start;
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        notifyGive((uint32_t)benchmarkPong);
+        notifyTake(true);
+    }
+    notifyClocks = TIMER2_TAV_R - start;
+
+    putsUart0("\nPing-pong\n");
+    printResult("post/wait", semaphoreClocks);
+    printResult("notifyGive/notifyTake", notifyClocks);
+
+    // Nobody else uses these semaphores, so this is the cost of the uncontended case
+    fastSemaphore fs;
+    int8_t benchUncontended = semOpen("benchUncontended");
+    fastSemaphoreInit(&fs, 1, semOpen("benchFast"));
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        wait(benchUncontended);
+        post(benchUncontended);
+    }
+    semaphoreClocks = TIMER2_TAV_R - start;
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        fastWait(&fs);
+        fastPost(&fs);
+    }
+    uint32_t fastClocks = TIMER2_TAV_R - start;
+
+    putsUart0("\nUncontended\n");
+    printResult("wait/post", semaphoreClocks);
+    printResult("fastWait/fastPost", fastClocks);
+
+    // Push and pop from the same task. Tasks can not share memory yet, so this compares
+    // the cost of the operations themselves rather than contention between tasks.
+    lockedQueue lq;
+    mpmcQueue mq;
+    mpmcCell cells[BENCHMARK_QUEUE_SIZE];
+    lq.head = lq.tail = 0;
+    lq.lock = semOpen("benchQueueLock");
+    lq.values = semOpen("benchQueueValues");
+    mpmcQueueInit(&mq, cells, BENCHMARK_QUEUE_SIZE, semOpen("benchMpmc"));
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        lockedQueuePush(&lq, i);
+        lockedQueuePop(&lq);
+    }
+    semaphoreClocks = TIMER2_TAV_R - start;
+
+    start = TIMER2_TAV_R;
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        mpmcQueuePush(&mq, i);
+        mpmcQueuePop(&mq);
+    }
+    fastClocks = TIMER2_TAV_R - start;
+
+    putsUart0("\nQueue push/pop\n");
+    printResult("semaphore queue", semaphoreClocks);
+    printResult("mpmc queue", fastClocks);
+
+    // Every read holds the lock for a tick, so readers that share a semaphore take turns
+    // while readers that share a reader-writer lock should all get in at once
+    uint8_t count;
+    putsUart0("\nReader scaling\n");
+    for(count = 1; count <= BENCHMARK_READERS; count++)
+        printReaderResult("wait/post", count, runReaders(count, READ_WITH_SEMAPHORE));
+    for(count = 1; count <= BENCHMARK_READERS; count++)
+        printReaderResult("readLock/readUnlock", count, runReaders(count, READ_WITH_RWLOCK));
+
+    while(true)
+        sleep(1000);
+}
+
+void benchmarkPong()
+{
+    uint16_t i;
+    int8_t benchPing = semOpen("benchPing");
+    int8_t benchPong = semOpen("benchPong");
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        wait(benchPing);
+        post(benchPong);
+    }
+    for(i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        notifyTake(true);
+        notifyGive((uint32_t)benchmarkPing);
+    }
+    while(true)
+        sleep(1000);
+}
+
+static void benchmarkReader()
+{
+    uint16_t i;
+    uint32_t mode;
+    int8_t benchSemaphore = semOpen("benchSemaphore");
+    int8_t benchRwLock = rwLockOpen("benchRwLock");
+    while(true)
+    {
+        mode = notifyTake(true);
+        for(i = 0; i < BENCHMARK_READER_ITERATIONS; i++)
+        {
+            if(mode == READ_WITH_RWLOCK)
+            {
+                readLock(benchRwLock);
+                sleep(1);
+                readUnlock(benchRwLock);
+            }
+            else
+            {
+                wait(benchSemaphore);
+                sleep(1);
+                post(benchSemaphore);
+            }
+        }
+        notifyGive((uint32_t)benchmarkPing);
+    }
+}
+
+// Each reader needs its own entry point because tasks are identified by their function
+void benchmarkReader1()
+{
+    benchmarkReader();
+}
+
+void benchmarkReader2()
+{
+    benchmarkReader();
+}
+
+void benchmarkReader3()
+{
+    benchmarkReader();
+}
+
+void benchmarkReader4()
+{
+    benchmarkReader();
+}
+
+bool createBenchmarkThreads()
+{
+    bool ok;
+
+    initTimer2();
+
+    ok = (createSemaphore("benchPing", 0) != -1);
+    ok &= (createSemaphore("benchPong", 0) != -1);
+    ok &= (createSemaphore("benchSemaphore", 1) != -1);
+    ok &= (createSemaphore("benchUncontended", 1) != -1);
+    ok &= (createSemaphore("benchFast", 0) != -1);
+    ok &= (createSemaphore("benchQueueLock", 1) != -1);
+    ok &= (createSemaphore("benchQueueValues", 0) != -1);
+    ok &= (createSemaphore("benchMpmc", 0) != -1);
+    ok &= (createRwLock("benchRwLock") != -1);
+
+    ok &= createThread(benchmarkIdle, "Idle", 7, 256);
+    ok &= createThread(benchmarkPing, "Ping", 0, 1024);
+    ok &= createThread(benchmarkPong, "Pong", 0, 1024);
+    ok &= createThread(benchmarkReader1, "Reader1", 0, 1024);
+    ok &= createThread(benchmarkReader2, "Reader2", 0, 1024);
+    ok &= createThread(benchmarkReader3, "Reader3", 0, 1024);
+    ok &= createThread(benchmarkReader4, "Reader4", 0, 1024);
+    return ok;
+}
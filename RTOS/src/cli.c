@@ -134,6 +134,82 @@ int32_t getFieldInteger(USER_DATA* data, uint8_t fieldNumber)
     return signedInteger32bits;
 }
 
+// Prints where the SRAM goes. This has its own stack frame, so the arrays it needs
+// do not add to the shell's.
+static void showMemory()
+{
+    memoryInfo mi;
+    heapInfo hi;
+    taskInfo ti[MAX_TASKS_TASK_INFO];
+    poolInfo pi[MAX_POOLS];
+    uint8_t tiCount = 0;
+    uint8_t piCount = 0;
+    uint8_t i = 0;
+    memInfo(&mi);
+    heapStats(&hi);
+    ps(ti, &tiCount);
+    pools(pi, &piCount);
+
+    putcUart0('\n');
+    printfString(20, "Kernel data (B)");
+    printfInteger("%u", 8, mi.kernelDataBytes);
+    putcUart0('\n');
+    printfString(20, "Kernel stack (B)");
+    printfInteger("%u", 8, mi.kernelStackBytes);
+    putcUart0('\n');
+    printfString(20, "Task arena (B)");
+    printfInteger("%u", 8, mi.arenaBytes);
+    putcUart0('\n');
+    printfString(20, "Heap (B)");
+    printfInteger("%u", 8, hi.allocatedBytes);
+    putcUart0('\n');
+    printfString(20, "Free (B)");
+    printfInteger("%u", 8, mi.freeBytes);
+    putsUart0("\n\n");
+
+    printfString(12, "Task Name");
+    printfString(12, "Stack Used");
+    printfString(12, "Stack Size");
+    putsUart0("\n");
+    for(; i < tiCount; i++)
+    {
+        printfString(12, ti[i].name);
+        printfInteger("%u", 12, ti[i].stackUsed);
+        printfInteger("%u", 12, ti[i].stackBytes);
+        putcUart0('\n');
+    }
+    putcUart0('\n');
+
+    printfString(12, "Pool");
+    printfString(12, "Used (B)");
+    printfString(12, "Size (B)");
+    putsUart0("\n");
+    for(i = 0; i < piCount; i++)
+    {
+        printfString(12, pi[i].name);
+        printfInteger("%u", 12, (uint32_t)pi[i].used * pi[i].blockSize);
+        printfInteger("%u", 12, (uint32_t)pi[i].blockCount * pi[i].blockSize);
+        putcUart0('\n');
+    }
+    putcUart0('\n');
+
+    // One line per 8KiB MPU region, one character per 1KiB subregion
+    putsUart0("K kernel, S stack, s small stacks, B buffer, P pool, H heap, M shared, . free\n");
+    for(i = 0; i < 32; i++)
+    {
+        if(i % 8 == 0)
+        {
+            putsUart0("0x");
+            printUint32InHex(mi.sramBase + i * 1024);
+            putcUart0(' ');
+        }
+        putcUart0(mi.map[i]);
+        if(i % 8 == 7)
+            putcUart0('\n');
+    }
+    putcUart0('\n');
+}
+
 void shell(void)
 {
     // initUart0();
@@ -164,6 +240,8 @@ void shell(void)
             printfString(12, "PID");
             printfString(15, "CPU Usage (%)");
             printfString(12, "State");
+            printfString(12, "Stack Used");
+            printfString(12, "Stack Size");
             putsUart0("\n\n");
             for(i = 0; i < tiCount; i++)
             {
@@ -209,6 +287,8 @@ void shell(void)
                     printfString(12, "KILLED");
                     break;
                 }
+                printfInteger("%u", 12, ti[i].stackUsed);
+                printfInteger("%u", 12, ti[i].stackBytes);
                 putcUart0('\n');
             }
             putcUart0('\n');
@@ -216,13 +296,14 @@ void shell(void)
         else if(isCommand(&data, "ipcs", 0))
         {
             semaphoreInfo semInfo[MAX_SEM_INFO_SIZE];
-            ipcs(semInfo);
+            uint8_t semInfoCount = 0;
+            ipcs(semInfo, &semInfoCount);
             printfString(14, "\nSemaphore");
             printfString(8, "Count");
             printfString(8, "Waiting");
             putsUart0("\n\n");
             uint8_t i = 0;
-            for(; i < MAX_SEM_INFO_SIZE; i++)
+            for(; i < semInfoCount; i++)
             {
                 printfString(14, semInfo[i].name);
                 printfInteger("%u", 8, semInfo[i].count);
@@ -233,6 +314,55 @@ void shell(void)
             }
             putcUart0('\n');
         }
+        else if(isCommand(&data, "heap", 0))
+        {
+            heapInfo hi;
+            heapStats(&hi);
+            putcUart0('\n');
+            printfString(20, "Allocations");
+            printfInteger("%u", 8, hi.allocations);
+            putcUart0('\n');
+            printfString(20, "Allocated (B)");
+            printfInteger("%u", 8, hi.allocatedBytes);
+            putcUart0('\n');
+            printfString(20, "Free (B)");
+            printfInteger("%u", 8, hi.freeBytes);
+            putcUart0('\n');
+            printfString(20, "Largest free (B)");
+            printfInteger("%u", 8, hi.largestFreeBytes);
+            putcUart0('\n');
+            // Share of the free memory that can not be handed out in one piece
+            printfString(20, "Fragmentation (%)");
+            printfInteger("%u", 8, hi.freeBytes ? 100 - (hi.largestFreeBytes * 100) / hi.freeBytes : 0);
+            putsUart0("\n\n");
+        }
+        else if(isCommand(&data, "mem", 0))
+            showMemory();
+        else if(isCommand(&data, "pools", 0))
+        {
+            poolInfo pi[MAX_POOLS];
+            uint8_t piCount = 0;
+            pools(pi, &piCount);
+            printfString(14, "\nPool");
+            printfString(8, "Size");
+            printfString(8, "Blocks");
+            printfString(8, "Used");
+            printfString(8, "Peak");
+            printfString(8, "Waiting");
+            putsUart0("\n\n");
+            uint8_t i = 0;
+            for(; i < piCount; i++)
+            {
+                printfString(14, pi[i].name);
+                printfInteger("%u", 8, pi[i].blockSize);
+                printfInteger("%u", 8, pi[i].blockCount);
+                printfInteger("%u", 8, pi[i].used);
+                printfInteger("%u", 8, pi[i].highWater);
+                printfInteger("%u", 8, pi[i].waiting);
+                putcUart0('\n');
+            }
+            putcUart0('\n');
+        }
         else if(isCommand(&data, "kill", 1))
         {
             uint32_t pid = hexStringToUint32(getFieldString(&data, 1));
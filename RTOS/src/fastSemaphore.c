@@ -0,0 +1,46 @@
+/*
+ * fastSemaphore.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#include "fastSemaphore.h"
+#include "atomic.h"
+#include "syscalls.h"
+
+void fastSemaphoreInit(fastSemaphore* fs, int32_t count, int8_t semaphore)
+{
+    fs->count = count;
+    fs->semaphore = semaphore;
+}
+
+// Takes a unit if one is free, otherwise blocks on the kernel semaphore until a post
+// hands one over
+void fastWait(fastSemaphore* fs)
+{
+    if((int32_t)atomicFetchAdd((volatile uint32_t*)&fs->count, (uint32_t)-1) <= 0)
+        wait(fs->semaphore);
+}
+
+// Takes a unit if one is free. Never blocks, returns false if no unit was free.
+bool fastTryWait(fastSemaphore* fs)
+{
+    int32_t count = fs->count;
+    while(count > 0)
+    {
+        if(atomicCompareExchange((volatile uint32_t*)&fs->count, count, count - 1))
+            return true;
+        count = fs->count;
+    }
+    return false;
+}
+
+// Gives a unit back. Only traps into the kernel if a task is waiting for it.
+// A waiter may have decremented the count but not reached wait() yet. The kernel
+// semaphore keeps the post until then, so the wake up is never lost.
+void fastPost(fastSemaphore* fs)
+{
+    if((int32_t)atomicFetchAdd((volatile uint32_t*)&fs->count, 1) < 0)
+        post(fs->semaphore);
+}
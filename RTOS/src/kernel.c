@@ -15,15 +15,26 @@
 #include "tString.h"
 #include "peripheral.h"
 
-#define SRAM_BASE                       0x20000000
+#define SRAM_BASE                       ((uint32_t)&__sram_start)
 #define EXEC_RETURN_THREAD_MODE         0xFFFFFFFD
 #define OFFSET_TO_PC_AFTER_FN_CALLED    6           // Total of 8 registers are pushed automatically when function called.
                                                     // Offset by 6 4-byte integers.
 #define OFFSET_TO_SVC_INSTRUCTION       2           // This is a 16 bit instruction.
+#define OFFSET_TO_R0_FROM_SAVED_SP      8           // R4 - R11 are pushed below the hardware stack frame by PendSV
+#define SUBREGION_SIZE                  0x400
+#define STACK_FILL_PATTERN              0xA5A5A5A5  // written over a new stack to measure its peak use
 
 typedef enum _svcNumber
 {
-    YIELD = 7, SLEEP, WAIT, POST, SCHED, PREEMPT_MODE, REBOOT, PID, KILL, RESUME, IPCS, PS
+    YIELD = 7, SLEEP, WAIT, POST, SCHED, PREEMPT_MODE, REBOOT, PID, KILL, RESUME, IPCS, PS,
+    SEND_BUFFER, RECEIVE_BUFFER, SET_EVENT_FLAGS, CLEAR_EVENT_FLAGS, WAIT_EVENT_FLAGS,
+    TIMED_WAIT, NOTIFY_GIVE, NOTIFY_SET_BITS, NOTIFY_OVERWRITE, NOTIFY_TAKE,
+    SEM_CREATE, SEM_OPEN, SEM_DELETE,
+    RWLOCK_OPEN, READ_LOCK, READ_UNLOCK, WRITE_LOCK, WRITE_UNLOCK,
+    MUTEX_OPEN, MUTEX_LOCK, MUTEX_UNLOCK, COND_OPEN, COND_WAIT, COND_SIGNAL, COND_BROADCAST,
+    PIPE_OPEN, PIPE_WRITE, PIPE_READ, SELECT, BARRIER_OPEN, BARRIER_WAIT,
+    ALLOCATE_MEMORY, FREE_MEMORY, HEAP_STATS, POOL_OPEN, POOL_ALLOC, POOL_FREE, POOLS,
+    SHM_OPEN, MEM_INFO
 } svcNumber;
 
 extern void pushR4ToR11Psp();
@@ -34,12 +45,17 @@ extern void pushPsp(uint32_t r0);
  * Global Variables
  */
 
-// The first 4KiB will be used by the OS. All other threads will get stack space
-// starting at 0x20001400
-uint32_t* heap = (uint32_t*)0x20001400;
+// One bit per 1KiB block of SRAM, set while the block is in use. Bit n is the block at
+// SRAM_BASE + n KiB, which is also the bit of its MPU subregion in a srd mask.
+// Only the blocks of the task arena are ever free, see initRtos().
+uint32_t blocksInUse = 0xFFFFFFFF;
+// Small stacks used in each block, bit n set while the nth SMALL_STACK_MIN slot is used.
+// A block only stays allocated while at least one of its slots is.
+uint8_t smallStackSlots[32];
 
 uint8_t taskCurrent = 0;        // index of last dispatched task
-uint8_t taskCount = 0;          // total number of valid tasks
+uint8_t taskCount = 0;          // number of tasks that can be scheduled
+uint8_t liveTasks[MAX_TASKS];   // tcb indices of those tasks, in ascending order
 uint32_t taskStartTime = 0;     // Time when a task starts executing
 uint32_t taskEndTime = 0;      // Time when a task ends executing
 
@@ -47,6 +63,35 @@ uint32_t cpuUsageTime[MAX_TASKS];
 uint16_t systickCount = 0;
 
 semaphore semaphores[MAX_SEMAPHORES];
+buffer buffers[MAX_BUFFERS];
+allocation allocations[MAX_ALLOCATIONS];
+sharedMemory sharedMemories[MAX_SHARED_MEMORY];
+pool blockPools[MAX_POOLS];
+// Subregions of all the pools, every task can access them
+uint32_t poolSrd = 0;
+eventGroup eventGroups[MAX_EVENT_GROUPS];
+rwLock rwLocks[MAX_RWLOCKS];
+mutex mutexes[MAX_MUTEXES];
+condition conditions[MAX_CONDITIONS];
+pipe pipes[MAX_PIPES];
+barrier barriers[MAX_BARRIERS];
+
+// Requests queued by ISRs. ISRs only ever move the tail and the kernel only ever moves the head.
+typedef enum _deferredRequestType
+{
+    DEFERRED_POST, DEFERRED_NOTIFY_GIVE, DEFERRED_NOTIFY_SET_BITS
+} deferredRequestType;
+
+typedef struct _deferredRequest
+{
+    deferredRequestType type;
+    uint32_t target;               // semaphore handle or PID
+    uint32_t value;
+} deferredRequest;
+
+deferredRequest deferredRequests[MAX_DEFERRED_REQUESTS];
+volatile uint8_t deferredHead = 0;
+volatile uint8_t deferredTail = 0;
 
 schedulerId schedulerIdCurrent = ROUND_ROBIN;
 bool preemption = false;
@@ -97,6 +142,638 @@ static uint32_t* getPsp()
     __asm(" MRS R0, PSP");
 }
 
+// Masks interrupts and returns the previous PRIMASK so that it can be restored
+static uint32_t disableInterrupts()
+{
+    __asm(" MRS R0, PRIMASK");
+    __asm(" CPSID I");
+}
+
+static void restoreInterrupts(uint32_t primask)
+{
+    __asm(" MSR PRIMASK, R0");
+}
+
+// A task that is not running has R4 - R11 saved below its hardware stack frame. Writing
+// into the stacked R0 is how a blocked syscall hands a return value to the task once it
+// is woken up.
+static void setTaskReturnValue(uint8_t task, uint32_t value)
+{
+    *((uint32_t*)tcb[task].sp + OFFSET_TO_R0_FROM_SAVED_SP) = value;
+}
+
+static void initWaitQueue(waitQueue* q)
+{
+    q->head = -1;
+    q->tail = -1;
+    q->size = 0;
+}
+
+// Links the task to the end of the wait queue
+static void addToWaitQueue(waitQueue* q, uint8_t task)
+{
+    tcb[task].queue = q;
+    tcb[task].prev = q->tail;
+    tcb[task].next = -1;
+    if(q->tail == -1)
+        q->head = task;
+    else
+        tcb[q->tail].next = task;
+    q->tail = task;
+    q->size++;
+}
+
+// Links the task in front of the first task with a lower priority, so the queue stays
+// sorted by priority and tasks of the same priority keep the order they arrived in
+static void addToWaitQueueByPriority(waitQueue* q, uint8_t task)
+{
+    int8_t t = q->head;
+    while(t != -1 && tcb[t].priority <= tcb[task].priority)
+        t = tcb[t].next;
+    if(t == -1)
+    {
+        addToWaitQueue(q, task);
+        return;
+    }
+    tcb[task].queue = q;
+    tcb[task].prev = tcb[t].prev;
+    tcb[task].next = t;
+    if(tcb[t].prev == -1)
+        q->head = task;
+    else
+        tcb[tcb[t].prev].next = task;
+    tcb[t].prev = task;
+    q->size++;
+}
+
+// Unlinks the task from whichever wait queue it is in
+static void removeFromWaitQueue(uint8_t task)
+{
+    waitQueue* q = tcb[task].queue;
+    if(q == 0)
+        return;
+    if(tcb[task].prev == -1)
+        q->head = tcb[task].next;
+    else
+        tcb[tcb[task].prev].next = tcb[task].next;
+    if(tcb[task].next == -1)
+        q->tail = tcb[task].prev;
+    else
+        tcb[tcb[task].next].prev = tcb[task].prev;
+    q->size--;
+    tcb[task].queue = 0;
+    tcb[task].prev = -1;
+    tcb[task].next = -1;
+}
+
+// Blocks the running task and switches to another one. The caller links the task into
+// the wait queue of the object it is waiting on, if there is one.
+static void blockCurrentTask(uint8_t blockedOn)
+{
+    tcb[taskCurrent].blockedOn = blockedOn;
+    tcb[taskCurrent].state = STATE_BLOCKED;
+    // Trigger a PendSV ISR call
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+}
+
+// Makes a blocked task ready again. The value ends up in R0 of the task, so it is what
+// the blocking syscall returns.
+static void wakeTask(uint8_t task, uint32_t returnValue)
+{
+    removeFromWaitQueue(task);
+    setTaskReturnValue(task, returnValue);
+    tcb[task].blockedOn = BLOCKED_ON_NONE;
+    tcb[task].timedWait = false;
+    tcb[task].state = STATE_READY;
+}
+
+// Reference: https://stackoverflow.com/questions/3407012/rounding-up-to-the-nearest-multiple-of-a-number
+uint32_t roundUp(uint32_t numToRound, uint32_t multiple)
+{
+    return ((numToRound + multiple - 1) / multiple) * multiple;
+}
+
+// Returns the SRD bits of the 1KiB subregions covered by [base, base + bytes)
+static uint32_t getSrdBits(uint32_t base, uint32_t bytes)
+{
+    uint32_t nSrd = roundUp(bytes, SUBREGION_SIZE) / SUBREGION_SIZE;
+    uint32_t bits = (nSrd >= 32) ? 0xFFFFFFFF : ((1 << nSrd) - 1);
+    return bits << ((base - SRAM_BASE) / SUBREGION_SIZE);
+}
+
+// Hands out the first run of free 1KiB blocks big enough for bytes, so that everything
+// given to a task lines up with the MPU subregions. Returns 0 if there is no such run.
+static uint32_t allocateBlocks(uint32_t bytes)
+{
+    uint32_t n = roundUp(bytes, SUBREGION_SIZE) / SUBREGION_SIZE;
+    uint32_t mask;
+    uint8_t i = 0;
+    if(n == 0 || n > 32)
+        return 0;
+    mask = (n == 32) ? 0xFFFFFFFF : ((1 << n) - 1);
+    for(; i + n <= 32; i++)
+        if((blocksInUse & (mask << i)) == 0)
+        {
+            blocksInUse |= mask << i;
+            return SRAM_BASE + i * SUBREGION_SIZE;
+        }
+    return 0;
+}
+
+static void freeBlocks(uint32_t base, uint32_t bytes)
+{
+    blocksInUse &= ~getSrdBits(base, bytes);
+}
+
+// Gives the blocks of an allocation back and takes them out of the owner's srd mask
+static void releaseAllocation(uint8_t a)
+{
+    uint32_t base = (uint32_t)allocations[a].base;
+    freeBlocks(base, allocations[a].size);
+    tcb[allocations[a].owner].srd &= ~getSrdBits(base, allocations[a].size);
+    allocations[a].base = 0;
+}
+
+// Returns the size a stack of bytes is rounded up to. A small stack has to be bigger than
+// its guard, and has to be a power of 2 to be covered by an MPU region of its own.
+static uint32_t getStackReservation(uint32_t bytes)
+{
+    uint32_t size = SMALL_STACK_MIN;
+    if(bytes > SMALL_STACK_MAX)
+        return roundUp(bytes, SUBREGION_SIZE);
+    while(size < bytes || size <= STACK_GUARD_SIZE)
+        size <<= 1;
+    return size;
+}
+
+// Hands out a small stack from a block that already holds small stacks, or starts a new
+// block. The stack is aligned to its size, as the MPU requires. Returns 0 if there is no room.
+static uint32_t allocateSmallStack(uint32_t bytes)
+{
+    uint8_t slots = bytes / SMALL_STACK_MIN;
+    uint8_t mask = (1 << slots) - 1;
+    uint8_t b = 0;
+    uint8_t s;
+    uint32_t base;
+    for(; b < 32; b++)
+        if(smallStackSlots[b] != 0)
+            for(s = 0; s < SUBREGION_SIZE / SMALL_STACK_MIN; s += slots)
+                if((smallStackSlots[b] & (mask << s)) == 0)
+                {
+                    smallStackSlots[b] |= mask << s;
+                    return SRAM_BASE + b * SUBREGION_SIZE + s * SMALL_STACK_MIN;
+                }
+    base = allocateBlocks(SUBREGION_SIZE);
+    if(base != 0)
+        smallStackSlots[(base - SRAM_BASE) / SUBREGION_SIZE] = mask;
+    return base;
+}
+
+static void freeSmallStack(uint32_t base, uint32_t bytes)
+{
+    uint8_t b = (base - SRAM_BASE) / SUBREGION_SIZE;
+    uint8_t s = (base % SUBREGION_SIZE) / SMALL_STACK_MIN;
+    smallStackSlots[b] &= ~(((1 << (bytes / SMALL_STACK_MIN)) - 1) << s);
+    if(smallStackSlots[b] == 0)
+        freeBlocks(base - (base % SUBREGION_SIZE), SUBREGION_SIZE);
+}
+
+// Takes a stack of bytes, a size returned by getStackReservation(), out of the SRAM.
+// Returns 0 if there is no room.
+static uint32_t takeStack(uint32_t bytes)
+{
+    return (bytes < SUBREGION_SIZE) ? allocateSmallStack(bytes) : allocateBlocks(bytes);
+}
+
+// Gives the task the stack at base, of tcb[task].stackBytes, and points sp at the top of it
+static void setStack(uint8_t task, uint32_t base)
+{
+    bool small = tcb[task].stackBytes < SUBREGION_SIZE;
+    tcb[task].stackBase = (void*)base;
+    // This is a fully descending stack, so it starts right above the last block
+    tcb[task].spInit = (void*)(base + tcb[task].stackBytes);
+    tcb[task].sp = tcb[task].spInit;
+    // Words the task never writes keep the pattern, see getStackUsed()
+    uint32_t* p = (uint32_t*)base;
+    while(p < (uint32_t*)tcb[task].spInit)
+        *p++ = STACK_FILL_PATTERN;
+    // Sets the SRD bits of all the blocks making up the stack. Region 6 gives access to
+    // a small stack instead, the rest of its block belongs to other tasks.
+    if(!small)
+        tcb[task].srd |= getSrdBits(base, tcb[task].stackBytes);
+}
+
+// Gives the task a new stack. Returns false if there is no room.
+static bool allocateStack(uint8_t task)
+{
+    uint32_t base = takeStack(tcb[task].stackBytes);
+    if(base == 0)
+        return false;
+    setStack(task, base);
+    return true;
+}
+
+// The stack grows down, so the lowest word that no longer holds the fill pattern marks
+// the deepest the task has gone. It is only measured when somebody asks for it.
+static uint32_t getStackUsed(uint8_t task)
+{
+    uint32_t* p = (uint32_t*)tcb[task].stackBase;
+    uint32_t* top = (uint32_t*)tcb[task].spInit;
+    if(p == 0)
+        return 0;
+    while(p < top && *p == STACK_FILL_PATTERN)
+        p++;
+    return (uint32_t)top - (uint32_t)p;
+}
+
+// Gives the stack blocks back. Any buffers the task owns stay mapped.
+static void freeStack(uint8_t task)
+{
+    if(tcb[task].stackBase == 0)
+        return;
+    if(tcb[task].stackBytes < SUBREGION_SIZE)
+        freeSmallStack((uint32_t)tcb[task].stackBase, tcb[task].stackBytes);
+    else
+    {
+        freeBlocks((uint32_t)tcb[task].stackBase, tcb[task].stackBytes);
+        tcb[task].srd &= ~getSrdBits((uint32_t)tcb[task].stackBase, tcb[task].stackBytes);
+    }
+    tcb[task].stackBase = 0;
+}
+
+// Handles come from user space, so they are checked before being used as an index
+static bool isSemaphore(uint32_t semaphore)
+{
+    return semaphore < MAX_SEMAPHORES && semaphores[semaphore].inUse;
+}
+
+static bool isRwLock(uint32_t lock)
+{
+    return lock < MAX_RWLOCKS && rwLocks[lock].inUse;
+}
+
+// Hands the lock to the highest priority writer waiting for it.
+// Returns false if no writer is waiting.
+static bool grantWriteLock(rwLock* l)
+{
+    int8_t t = l->writersWaiting.head;
+    if(t == -1)
+        return false;
+    l->writer = t;
+    wakeTask(t, true);
+    return true;
+}
+
+// Lets every waiting reader in at once
+static void grantReadLocks(rwLock* l)
+{
+    while(l->readersWaiting.head != -1)
+    {
+        l->readers |= 1 << l->readersWaiting.head;
+        wakeTask(l->readersWaiting.head, true);
+    }
+}
+
+// Called after a hold on the lock was given up or a waiting writer went away.
+// Hands the lock to whoever can have it now.
+static void serviceRwLock(rwLock* l)
+{
+    if(l->writer != -1)
+        return;
+    // Another writer goes first, otherwise all the waiting readers get in together
+    if(l->readers == 0 && grantWriteLock(l))
+        return;
+    // Readers only queue up behind a writer, so with none left waiting they can join
+    if(l->writersWaiting.size == 0)
+        grantReadLocks(l);
+}
+
+static bool isMutex(uint32_t m)
+{
+    return m < MAX_MUTEXES && mutexes[m].inUse;
+}
+
+static bool isCondition(uint32_t c)
+{
+    return c < MAX_CONDITIONS && conditions[c].inUse;
+}
+
+// Gives the mutex to the highest priority task waiting for it, or frees it if there is none.
+// The new owner gets back the lock depth it had saved before blocking.
+static void releaseMutex(mutex* m)
+{
+    int8_t t = m->waiting.head;
+    if(t == -1)
+    {
+        m->owner = -1;
+        m->depth = 0;
+        return;
+    }
+    m->owner = t;
+    m->depth = tcb[t].mutexDepth;
+    wakeTask(t, MUTEX_OK);
+}
+
+// Moves the first task waiting on the condition onto the queue of the mutex it waited with.
+// It is only made ready if the mutex happens to be free.
+// Returns false if no task is waiting.
+static bool signalCondition(condition* c)
+{
+    int8_t t = c->waiting.head;
+    if(t == -1)
+        return false;
+    removeFromWaitQueue(t);
+    mutex* m = &mutexes[tcb[t].mutex];
+    if(m->owner == -1)
+    {
+        m->owner = t;
+        m->depth = tcb[t].mutexDepth;
+        wakeTask(t, MUTEX_OK);
+    }
+    else
+    {
+        addToWaitQueueByPriority(&m->waiting, t);
+        tcb[t].blockedOn = BLOCKED_ON_MUTEX;
+    }
+    return true;
+}
+
+static bool isPool(uint32_t p)
+{
+    return p < MAX_POOLS && blockPools[p].inUse;
+}
+
+// A block handed back has to be one of the blocks of the pool that is allocated
+static bool isPoolBlock(pool* p, uint32_t block)
+{
+    uint32_t offset = block - (uint32_t)p->base;
+    uint16_t n = offset / p->blockSize;
+    return block >= (uint32_t)p->base && offset < (uint32_t)p->blockSize * p->blockCount &&
+           offset % p->blockSize == 0 && (p->allocated[n / 32] & (1 << (n % 32)));
+}
+
+// Marks the first free block of the pool as allocated and returns its address, or 0 if
+// all the blocks are in use. Full words of the bitmap are skipped.
+static uint32_t allocatePoolBlock(pool* p)
+{
+    uint16_t n = 0;
+    if(p->used == p->blockCount)
+        return 0;
+    for(; n < p->blockCount; n++)
+    {
+        if(n % 32 == 0 && p->allocated[n / 32] == 0xFFFFFFFF)
+            n += 31;
+        else if(!(p->allocated[n / 32] & (1 << (n % 32))))
+        {
+            p->allocated[n / 32] |= 1 << (n % 32);
+            return (uint32_t)p->base + (uint32_t)n * p->blockSize;
+        }
+    }
+    return 0;
+}
+
+// The block has to have passed isPoolBlock()
+static void freePoolBlock(pool* p, uint32_t block)
+{
+    uint16_t n = (block - (uint32_t)p->base) / p->blockSize;
+    p->allocated[n / 32] &= ~(1 << (n % 32));
+}
+
+static bool isBarrier(uint32_t b)
+{
+    return b < MAX_BARRIERS && barriers[b].inUse;
+}
+
+static bool isPipe(uint32_t p)
+{
+    return p < MAX_PIPES && pipes[p].inUse;
+}
+
+// Returns the index of the first item that is ready, or -1 if none of them are
+static int8_t selectReady(const selectItem items[], uint8_t count)
+{
+    uint8_t i = 0;
+    for(; i < count; i++)
+        switch(items[i].type)
+        {
+        case SELECT_SEMAPHORE:
+            if(isSemaphore(items[i].handle) && semaphores[items[i].handle].count > 0)
+                return i;
+            break;
+        case SELECT_PIPE:
+            if(isPipe(items[i].handle) && pipes[items[i].handle].count >= pipes[items[i].handle].trigger)
+                return i;
+            break;
+        case SELECT_EVENT:
+            if((uint8_t)items[i].handle < MAX_EVENT_GROUPS && (eventGroups[items[i].handle].flags & items[i].flags))
+                return i;
+            break;
+        }
+    return -1;
+}
+
+// Called whenever an object may have become ready. Wakes up every selecting task that
+// has a ready object, with the index of that object.
+static void wakeSelectors()
+{
+    uint8_t n = 0;
+    uint8_t i;
+    int8_t ready;
+    for(; n < taskCount; n++)
+        if(tcb[i = liveTasks[n]].state == STATE_BLOCKED && tcb[i].blockedOn == BLOCKED_ON_SELECT)
+        {
+            ready = selectReady(tcb[i].selectItems, tcb[i].selectCount);
+            if(ready != -1)
+                wakeTask(i, ready);
+        }
+}
+
+// Copies as many bytes as fit into the pipe and returns how many were copied
+static uint32_t pipeCopyIn(pipe* p, const uint8_t* data, uint32_t bytes)
+{
+    uint32_t n = 0;
+    while(n < bytes && p->count < PIPE_SIZE)
+    {
+        p->data[p->tail] = data[n++];
+        p->tail = (p->tail + 1) & (PIPE_SIZE - 1);
+        p->count++;
+    }
+    return n;
+}
+
+// Copies as many bytes as are in the pipe, up to bytes, and returns how many were copied
+static uint32_t pipeCopyOut(pipe* p, uint8_t* data, uint32_t bytes)
+{
+    uint32_t n = 0;
+    while(n < bytes && p->count > 0)
+    {
+        data[n++] = p->data[p->head];
+        p->head = (p->head + 1) & (PIPE_SIZE - 1);
+        p->count--;
+    }
+    return n;
+}
+
+// Bytes that have to be in the pipe before the reader is woken up
+static uint32_t pipeReadLevel(pipe* p, uint8_t task)
+{
+    return tcb[task].ioBytes < p->trigger ? tcb[task].ioBytes : p->trigger;
+}
+
+// Moves data from blocked writers into the pipe and from the pipe to blocked readers,
+// waking each task as soon as its request is complete. A reader draining the pipe makes
+// room for the next writer and the other way around, so this keeps going until neither
+// side can make progress.
+static void servicePipe(pipe* p)
+{
+    int8_t t;
+    uint32_t n;
+    bool progress = true;
+    while(progress)
+    {
+        progress = false;
+        t = p->writersWaiting.head;
+        if(t != -1 && p->count < PIPE_SIZE)
+        {
+            n = pipeCopyIn(p, tcb[t].ioBuffer, tcb[t].ioBytes);
+            tcb[t].ioBuffer += n;
+            tcb[t].ioBytes -= n;
+            tcb[t].ioDone += n;
+            if(tcb[t].ioBytes == 0)
+                wakeTask(t, tcb[t].ioDone);
+            progress = true;
+        }
+        t = p->readersWaiting.head;
+        if(t != -1 && p->count >= pipeReadLevel(p, t))
+        {
+            n = pipeCopyOut(p, tcb[t].ioBuffer, tcb[t].ioBytes);
+            wakeTask(t, n);
+            progress = true;
+        }
+    }
+    wakeSelectors();
+}
+
+// A reader whose timeout ran out gets whatever is in the pipe. Readers are served in the
+// order they arrived, so one that is not next in line gets nothing, even if there are bytes.
+static void timeoutPipeRead(uint8_t task)
+{
+    uint8_t i = 0;
+    uint32_t n;
+    for(; i < MAX_PIPES; i++)
+        if(tcb[task].queue == &pipes[i].readersWaiting)
+        {
+            n = 0;
+            if(pipes[i].readersWaiting.head == task)
+                n = pipeCopyOut(&pipes[i], tcb[task].ioBuffer, tcb[task].ioBytes);
+            wakeTask(task, n);
+            servicePipe(&pipes[i]);
+            return;
+        }
+}
+
+// Returns the index of the live task with matching PID or -1 if there is none
+static int8_t findTask(uint32_t pid)
+{
+    uint8_t n = 0;
+    for(; n < taskCount; n++)
+        if((uint32_t)tcb[liveTasks[n]].pid == pid)
+            return liveTasks[n];
+    return -1;
+}
+
+// Called after the notification word of a task changed. If the task is blocked in
+// notifyTake() and the word is now non-zero, the take is completed on its behalf.
+// The target is known, so there is no queue to walk.
+static void notifyTask(uint8_t task)
+{
+    uint32_t value = tcb[task].notifyValue;
+    if(tcb[task].state == STATE_BLOCKED && tcb[task].blockedOn == BLOCKED_ON_NOTIFY && value != 0)
+    {
+        tcb[task].notifyValue = (tcb[task].notifyClear) ? 0 : value - 1;
+        wakeTask(task, value);
+    }
+}
+
+// If a task is waiting in the queue, the post goes straight to it. Otherwise,
+// increment the count for the selected semaphore.
+static void postSemaphore(uint8_t semaphore)
+{
+    if(semaphores[semaphore].waiting.head != -1)
+        wakeTask(semaphores[semaphore].waiting.head, WAIT_ACQUIRED);
+    else
+    {
+        semaphores[semaphore].count++;
+        wakeSelectors();
+    }
+}
+
+// Applies the requests queued by ISRs. This only runs in the systick and PendSV ISRs,
+// which can not be preempted by the ISRs adding requests, so only the tail can move
+// while the queue is being drained.
+static void processDeferredRequests()
+{
+    while(deferredHead != deferredTail)
+    {
+        deferredRequest* r = &deferredRequests[deferredHead & (MAX_DEFERRED_REQUESTS - 1)];
+        int8_t t;
+        switch(r->type)
+        {
+        case DEFERRED_POST:
+            if(isSemaphore(r->target))
+                postSemaphore(r->target);
+            break;
+        case DEFERRED_NOTIFY_GIVE:
+            t = findTask(r->target);
+            if(t != -1)
+            {
+                tcb[t].notifyValue++;
+                notifyTask(t);
+            }
+            break;
+        case DEFERRED_NOTIFY_SET_BITS:
+            t = findTask(r->target);
+            if(t != -1)
+            {
+                tcb[t].notifyValue |= r->value;
+                notifyTask(t);
+            }
+            break;
+        }
+        deferredHead++;
+    }
+}
+
+// Queues a request for the kernel. ISRs of different priorities can preempt each other,
+// so interrupts are masked while a slot is claimed.
+static bool deferRequest(deferredRequestType type, uint32_t target, uint32_t value)
+{
+    uint32_t primask = disableInterrupts();
+    bool ok = (uint8_t)(deferredTail - deferredHead) < MAX_DEFERRED_REQUESTS;
+    if(ok)
+    {
+        deferredRequest* r = &deferredRequests[deferredTail & (MAX_DEFERRED_REQUESTS - 1)];
+        r->type = type;
+        r->target = target;
+        r->value = value;
+        deferredTail++;
+    }
+    restoreInterrupts(primask);
+    // With preemption on, the woken task gets a chance to run as soon as the ISR is done.
+    // Otherwise the request waits for the next systick so the running task is not switched out.
+    if(ok && preemption)
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    return ok;
+}
+
+// Returns true if the flags currently set satisfy what the task is waiting for
+static bool eventFlagsSatisfied(uint32_t flags, uint32_t wanted, uint8_t options)
+{
+    if(options & EVENT_WAIT_ALL)
+        return (flags & wanted) == wanted;
+    return (flags & wanted) != 0;
+}
+
 void enableExceptionHandler(uint32_t type)
 {
     NVIC_SYS_HND_CTRL_R |= type;
@@ -168,8 +845,60 @@ void sRAMSubregionEnable(uint8_t region, uint32_t subregion)
     NVIC_MPU_ATTR_R &= ~(subregion << 8);
 }
 
+// Returns the SIZE field for a region of bytes, where bytes = 2^(SIZE + 1)
+static uint32_t getRegionSize(uint32_t bytes)
+{
+    uint32_t size = 0;
+    while((2u << size) < bytes)
+        size++;
+    return size;
+}
+
+// Region 7 has the highest priority, so it takes away the access the task's srd gives
+// it to the bottom of its stack. The kernel keeps access, it is allowed to read and write
+// the guard, for example to save the context of a task that overflowed.
+// Pass 0 when there is no stack to guard.
+void setStackGuard(uint32_t stackBase)
+{
+    NVIC_MPU_NUMBER_R = REGION_7;
+    if(STACK_GUARD_SIZE == 0 || stackBase == 0)
+    {
+        NVIC_MPU_ATTR_R = 0;
+        return;
+    }
+    // Base address | Valid Bit | Region Number
+    NVIC_MPU_BASE_R = stackBase | NVIC_MPU_BASE_VALID | REGION_7;
+    NVIC_MPU_ATTR_R = NVIC_MPU_ATTR_XN | AP_ACCESS_PRIVILEGE | NVIC_MPU_ATTR_SHAREABLE | NVIC_MPU_ATTR_CACHEABLE
+                    | R_SIZE(getRegionSize(STACK_GUARD_SIZE)) | NVIC_MPU_ATTR_ENABLE;
+}
+
+// Region 6 covers the running task's stack if it is a small one. It is below the guard
+// in priority, so the guard still applies.
+// Pass a stackBytes of a whole block or more to turn it off.
+void setSmallStackRegion(uint32_t stackBase, uint32_t stackBytes)
+{
+    NVIC_MPU_NUMBER_R = REGION_6;
+    if(stackBase == 0 || stackBytes >= SUBREGION_SIZE)
+    {
+        NVIC_MPU_ATTR_R = 0;
+        return;
+    }
+    // Base address | Valid Bit | Region Number
+    NVIC_MPU_BASE_R = stackBase | NVIC_MPU_BASE_VALID | REGION_6;
+    NVIC_MPU_ATTR_R = NVIC_MPU_ATTR_XN | AP_FULL_ACCESS | NVIC_MPU_ATTR_SHAREABLE | NVIC_MPU_ATTR_CACHEABLE
+                    | R_SIZE(getRegionSize(stackBytes)) | NVIC_MPU_ATTR_ENABLE;
+}
+
+// A task that faults in its guard ran off the end of its stack
+static bool isInStackGuard(uint8_t task, uint32_t address)
+{
+    uint32_t base = (uint32_t)tcb[task].stackBase;
+    return base != 0 && address >= base && address < base + STACK_GUARD_SIZE;
+}
+
 void setSrdBits(uint32_t srd)
 {
+    srd |= poolSrd;
     sRAMSubregionDisable(REGION_2, (srd >> 0) & 0x000000FF);
     sRAMSubregionDisable(REGION_3, (srd >> 8) & 0x000000FF);
     sRAMSubregionDisable(REGION_4, (srd >> 16) & 0x000000FF);
@@ -190,31 +919,49 @@ void enableMPU()
 // REQUIRED: in preemptive code, add code to request task switch
 void systickIsr()
 {
-    uint8_t i = 0;
+    uint8_t n = 0;
+    uint8_t i;
     // Sleep implementation
     // The Systick Isr is being called @1KHz
     // So, if a task was delayed it will not get scheduled, decrement the ticks (in ms) until it reaches 0
     // Until ticks reaches 0, the task will be sleeping (not get scheduled). Afterwards, we change it to ready,
     // so that it does get scheduled.
-    for(; i < taskCount; i++)
-        if(tcb[i].state == STATE_DELAYED)
+    // A task blocked in timedWait() counts down the same way. If it runs out of ticks before
+    // being posted, it is unlinked from the semaphore queue and told that the wait timed out.
+    for(; n < taskCount; n++)
+        if(tcb[i = liveTasks[n]].state == STATE_DELAYED)
         {
             if(tcb[i].ticks == 0)
-            {
                 tcb[i].state = STATE_READY;
-                return;
+            else
+                tcb[i].ticks--;
+        }
+        else if(tcb[i].state == STATE_BLOCKED && tcb[i].timedWait)
+        {
+            if(tcb[i].ticks == 0)
+            {
+                if(tcb[i].blockedOn == BLOCKED_ON_PIPE)
+                    timeoutPipeRead(i);
+                else if(tcb[i].blockedOn == BLOCKED_ON_SELECT)
+                    wakeTask(i, (uint32_t)-1);
+                else
+                    wakeTask(i, WAIT_TIMEOUT);
             }
-            tcb[i].ticks--;
+            else
+                tcb[i].ticks--;
         }
 
+    // Apply what ISRs posted since the last context switch
+    processDeferredRequests();
+
     // Every second, accumulate the total time of all the tasks run
     if(systickCount == TWO_SECOND_SYSTICK)
     {
         systickCount = 0;
-        for(i = 0; i < taskCount; i++)
+        for(n = 0; n < taskCount; n++)
         {
-            if(tcb[i].state != STATE_INVALID)
-                cpuUsageTime[i] = tcb[i].time;
+            i = liveTasks[n];
+            cpuUsageTime[i] = tcb[i].time;
             tcb[i].time = 0;
         }
     }
@@ -262,96 +1009,730 @@ void svCallIsr()
     // otherwise, we want for a post to occur until the task resumes execution.
     // Store all relevant information about the task semaphore.
     case WAIT:
+        if(!isSemaphore(*psp))
+            break;
         if(semaphores[*psp].count > 0)
             semaphores[*psp].count--;
         else
         {
-            if(semaphores[*psp].queueSize < MAX_QUEUE_SIZE)
-            {
-                semaphores[*psp].processQueue[semaphores[*psp].queueSize++] = taskCurrent;
-                // Store a pointer to the semaphore the task is waiting on
-                tcb[taskCurrent].semaphore = (void*)(semaphores + *psp);
-                tcb[taskCurrent].state = STATE_BLOCKED;
-                // Trigger a PendSV ISR call
-                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
-            }
+            // Link the task into the semaphore queue
+            addToWaitQueue(&semaphores[*psp].waiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_SEMAPHORE);
+        }
+        break;
+    case POST:
+        if(isSemaphore(*psp))
+            postSemaphore(*psp);
+        break;
+    case TIMED_WAIT:
+        // Function signature: uint8_t timedWait(int8_t semaphore, uint32_t ticks)
+        // Same as WAIT, except the task also counts down its ticks in the systick ISR
+        // like a sleeping task. Whichever comes first, a post or the timeout, wakes it up.
+        if(!isSemaphore(*psp))
+            *psp = WAIT_TIMEOUT;
+        else if(semaphores[*psp].count > 0)
+        {
+            semaphores[*psp].count--;
+            *psp = WAIT_ACQUIRED;
+        }
+        else if(*(psp + 1) == 0)
+            *psp = WAIT_TIMEOUT;
+        else
+        {
+            addToWaitQueue(&semaphores[*psp].waiting, taskCurrent);
+            tcb[taskCurrent].ticks = *(psp + 1);
+            tcb[taskCurrent].timedWait = true;
+            blockCurrentTask(BLOCKED_ON_SEMAPHORE);
+        }
+        break;
+
+    // IMPORTANT: *psp is the PID of the task to notify for give, set bits and overwrite.
+    // All of them return false if no such task exists.
+
+    case NOTIFY_GIVE:
+        // Function signature: bool notifyGive(uint32_t pid)
+        {
+        int8_t t = findTask(*psp);
+        if(t != -1)
+        {
+            tcb[t].notifyValue++;
+            notifyTask(t);
+        }
+        *psp = (t != -1);
+        }
+        break;
+    case NOTIFY_SET_BITS:
+        // Function signature: bool notifySetBits(uint32_t pid, uint32_t bits)
+        {
+        int8_t t = findTask(*psp);
+        if(t != -1)
+        {
+            tcb[t].notifyValue |= *(psp + 1);
+            notifyTask(t);
+        }
+        *psp = (t != -1);
+        }
+        break;
+    case NOTIFY_OVERWRITE:
+        // Function signature: bool notifyOverwrite(uint32_t pid, uint32_t value)
+        {
+        int8_t t = findTask(*psp);
+        if(t != -1)
+        {
+            tcb[t].notifyValue = *(psp + 1);
+            notifyTask(t);
+        }
+        *psp = (t != -1);
+        }
+        break;
+    case NOTIFY_TAKE:
+        // Function signature: uint32_t notifyTake(bool clear)
+        // Returns the notification word as it was before it was decremented or cleared
+        {
+        uint32_t value = tcb[taskCurrent].notifyValue;
+        bool clear = (bool)*psp;
+        if(value != 0)
+        {
+            tcb[taskCurrent].notifyValue = (clear) ? 0 : value - 1;
+            *psp = value;
+        }
+        else
+        {
+            tcb[taskCurrent].notifyClear = clear;
+            blockCurrentTask(BLOCKED_ON_NOTIFY);
+        }
+        }
+        break;
+    case SEM_CREATE:
+        // Function signature: int8_t semCreate(const char name[], uint8_t count)
+        *psp = createSemaphore((const char*)*psp, (uint8_t)*(psp + 1));
+        break;
+    case SEM_OPEN:
+        // Function signature: int8_t semOpen(const char name[])
+        *psp = findSemaphore((const char*)*psp);
+        break;
+    case SEM_DELETE:
+        // Function signature: bool semDelete(int8_t semaphore)
+        *psp = deleteSemaphore((int8_t)*psp);
+        break;
+
+    // IMPORTANT: *psp is the lock handle for all the reader-writer lock calls.
+    // Lock calls return false without blocking if the handle is not valid, and writeLock
+    // does so too if the caller already holds the lock.
+    // Unlock calls return false if the caller does not hold the lock.
+
+    case RWLOCK_OPEN:
+        // Function signature: int8_t rwLockOpen(const char name[])
+        *psp = findRwLock((const char*)*psp);
+        break;
+    case READ_LOCK:
+        // Function signature: bool readLock(int8_t lock)
+        {
+        if(!isRwLock(*psp))
+        {
+            *psp = false;
+            break;
+        }
+        rwLock* l = &rwLocks[*psp];
+        *psp = true;
+        // New readers do not get in while a writer is waiting, so writers can not starve.
+        // A task that already reads is let through, waiting would deadlock with the writer.
+        if((l->writer == -1 && l->writersWaiting.size == 0) || (l->readers & (1 << taskCurrent)))
+            l->readers |= 1 << taskCurrent;
+        else
+        {
+            addToWaitQueueByPriority(&l->readersWaiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_RWLOCK);
+        }
+        }
+        break;
+    case READ_UNLOCK:
+        // Function signature: bool readUnlock(int8_t lock)
+        {
+        if(!isRwLock(*psp) || !(rwLocks[*psp].readers & (1 << taskCurrent)))
+        {
+            *psp = false;
+            break;
+        }
+        rwLock* l = &rwLocks[*psp];
+        *psp = true;
+        l->readers &= ~(1 << taskCurrent);
+        serviceRwLock(l);
+        }
+        break;
+    case WRITE_LOCK:
+        // Function signature: bool writeLock(int8_t lock)
+        {
+        if(!isRwLock(*psp))
+        {
+            *psp = false;
+            break;
+        }
+        rwLock* l = &rwLocks[*psp];
+        // A task that already holds the lock would wait for itself forever
+        if(l->writer == taskCurrent || (l->readers & (1 << taskCurrent)))
+        {
+            *psp = false;
+            break;
+        }
+        *psp = true;
+        if(l->writer == -1 && l->readers == 0)
+            l->writer = taskCurrent;
+        else
+        {
+            addToWaitQueueByPriority(&l->writersWaiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_RWLOCK);
+        }
+        }
+        break;
+    case WRITE_UNLOCK:
+        // Function signature: bool writeUnlock(int8_t lock)
+        {
+        if(!isRwLock(*psp) || rwLocks[*psp].writer != taskCurrent)
+        {
+            *psp = false;
+            break;
+        }
+        rwLock* l = &rwLocks[*psp];
+        *psp = true;
+        l->writer = -1;
+        serviceRwLock(l);
+        }
+        break;
+    case MUTEX_OPEN:
+        // Function signature: int8_t mutexOpen(const char name[])
+        *psp = findMutex((const char*)*psp);
+        break;
+    case MUTEX_LOCK:
+        // Function signature: uint8_t mutexLock(int8_t mutex)
+        {
+        if(!isMutex(*psp))
+        {
+            *psp = MUTEX_INVALID;
+            break;
+        }
+        mutex* m = &mutexes[*psp];
+        *psp = MUTEX_OK;
+        if(m->owner == -1)
+        {
+            m->owner = taskCurrent;
+            m->depth = 1;
+        }
+        else if(m->owner == taskCurrent)
+        {
+            if(m->depth == 0xFF)
+                *psp = MUTEX_RECURSION_LIMIT;
+            else
+                m->depth++;
+        }
+        else
+        {
+            tcb[taskCurrent].mutexDepth = 1;
+            addToWaitQueueByPriority(&m->waiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_MUTEX);
+        }
+        }
+        break;
+    case MUTEX_UNLOCK:
+        // Function signature: uint8_t mutexUnlock(int8_t mutex)
+        {
+        if(!isMutex(*psp))
+        {
+            *psp = MUTEX_INVALID;
+            break;
+        }
+        mutex* m = &mutexes[*psp];
+        if(m->owner != taskCurrent)
+        {
+            *psp = MUTEX_NOT_OWNER;
+            break;
+        }
+        *psp = MUTEX_OK;
+        if(--m->depth == 0)
+            releaseMutex(m);
+        }
+        break;
+    case COND_OPEN:
+        // Function signature: int8_t condOpen(const char name[])
+        *psp = findCondition((const char*)*psp);
+        break;
+    case COND_WAIT:
+        // Function signature: uint8_t condWait(int8_t condition, int8_t mutex)
+        {
+        uint32_t c = *psp;
+        uint32_t m = *(psp + 1);
+        if(!isCondition(c) || !isMutex(m))
+        {
+            *psp = MUTEX_INVALID;
+            break;
+        }
+        if(mutexes[m].owner != taskCurrent)
+        {
+            *psp = MUTEX_NOT_OWNER;
+            break;
+        }
+        // The mutex is given up completely, however many times the task has locked it,
+        // and is handed back at the same depth when the task is woken up
+        tcb[taskCurrent].mutex = m;
+        tcb[taskCurrent].mutexDepth = mutexes[m].depth;
+        releaseMutex(&mutexes[m]);
+        addToWaitQueueByPriority(&conditions[c].waiting, taskCurrent);
+        blockCurrentTask(BLOCKED_ON_CONDITION);
+        }
+        break;
+    case COND_SIGNAL:
+        // Function signature: uint8_t condSignal(int8_t condition)
+        if(!isCondition(*psp))
+        {
+            *psp = MUTEX_INVALID;
+            break;
+        }
+        signalCondition(&conditions[*psp]);
+        *psp = MUTEX_OK;
+        break;
+    case COND_BROADCAST:
+        // Function signature: uint8_t condBroadcast(int8_t condition)
+        if(!isCondition(*psp))
+        {
+            *psp = MUTEX_INVALID;
+            break;
+        }
+        while(signalCondition(&conditions[*psp]));
+        *psp = MUTEX_OK;
+        break;
+    case PIPE_OPEN:
+        // Function signature: int8_t pipeOpen(const char name[])
+        *psp = findPipe((const char*)*psp);
+        break;
+    case PIPE_WRITE:
+        // Function signature: uint32_t pipeWrite(int8_t pipe, const void* data, uint32_t bytes)
+        {
+        if(!isPipe(*psp))
+        {
+            *psp = 0;
+            break;
+        }
+        pipe* p = &pipes[*psp];
+        uint8_t* data = (uint8_t*)*(psp + 1);
+        uint32_t bytes = *(psp + 2);
+        uint32_t done = 0;
+        uint32_t n;
+        // Writers that are already waiting go first, so the stream stays in order
+        if(p->writersWaiting.head == -1)
+        {
+            // Every time a reader takes its share there may be room for more
+            do
+            {
+                n = pipeCopyIn(p, data + done, bytes - done);
+                done += n;
+                servicePipe(p);
+            } while(n > 0 && done < bytes);
+        }
+        if(done == bytes)
+            *psp = bytes;
+        else
+        {
+            tcb[taskCurrent].ioBuffer = data + done;
+            tcb[taskCurrent].ioBytes = bytes - done;
+            tcb[taskCurrent].ioDone = done;
+            addToWaitQueue(&p->writersWaiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_PIPE);
+        }
+        }
+        break;
+    case PIPE_READ:
+        // Function signature: uint32_t pipeRead(int8_t pipe, void* data, uint32_t bytes, uint32_t ticks)
+        {
+        if(!isPipe(*psp))
+        {
+            *psp = 0;
+            break;
+        }
+        pipe* p = &pipes[*psp];
+        uint8_t* data = (uint8_t*)*(psp + 1);
+        uint32_t bytes = *(psp + 2);
+        uint32_t ticks = *(psp + 3);
+        tcb[taskCurrent].ioBuffer = data;
+        tcb[taskCurrent].ioBytes = bytes;
+        if((p->readersWaiting.head == -1 && p->count >= pipeReadLevel(p, taskCurrent)) || ticks == 0)
+        {
+            *psp = pipeCopyOut(p, data, bytes);
+            // Writers waiting for room can carry on
+            servicePipe(p);
+        }
+        else
+        {
+            addToWaitQueue(&p->readersWaiting, taskCurrent);
+            if(ticks != WAIT_FOREVER)
+            {
+                tcb[taskCurrent].ticks = ticks;
+                tcb[taskCurrent].timedWait = true;
+            }
+            blockCurrentTask(BLOCKED_ON_PIPE);
+        }
+        }
+        break;
+    case SELECT:
+        // Function signature: int8_t selectWait(const selectItem items[], uint8_t count, uint32_t ticks)
+        // The task is not linked into the wait queues of the objects. Instead, whatever makes
+        // an object ready checks every selecting task, which is cheap with so few tasks.
+        {
+        const selectItem* items = (const selectItem*)*psp;
+        uint8_t count = *(psp + 1);
+        uint32_t ticks = *(psp + 2);
+        int8_t ready;
+        if(count > MAX_SELECT_ITEMS)
+            count = MAX_SELECT_ITEMS;
+        ready = selectReady(items, count);
+        if(ready != -1 || ticks == 0 || count == 0)
+            *psp = ready;
+        else
+        {
+            tcb[taskCurrent].selectItems = items;
+            tcb[taskCurrent].selectCount = count;
+            if(ticks != WAIT_FOREVER)
+            {
+                tcb[taskCurrent].ticks = ticks;
+                tcb[taskCurrent].timedWait = true;
+            }
+            blockCurrentTask(BLOCKED_ON_SELECT);
+        }
+        }
+        break;
+    case BARRIER_OPEN:
+        // Function signature: int8_t barrierOpen(const char name[])
+        *psp = findBarrier((const char*)*psp);
+        break;
+    case BARRIER_WAIT:
+        // Function signature: int8_t barrierWait(int8_t barrier)
+        {
+        if(!isBarrier(*psp))
+        {
+            *psp = (uint32_t)-1;
+            break;
+        }
+        barrier* b = &barriers[*psp];
+        if(++b->arrived < b->parties)
+        {
+            addToWaitQueue(&b->waiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_BARRIER);
+            break;
+        }
+        // The last task to arrive makes every waiter ready in one go and then asks for a
+        // single reschedule, instead of one per task released
+        while(b->waiting.head != -1)
+            wakeTask(b->waiting.head, 0);
+        b->arrived = 0;
+        *psp = BARRIER_SERIAL;
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+        }
+        break;
+    case SCHED:
+        // Function signature: void sched(bool prioOn)
+        schedulerIdCurrent = ((bool)*psp) ? PRIORITY : ROUND_ROBIN;
+        break;
+    case PREEMPT_MODE:
+        preemption = ((bool)*psp) ? true : false;
+        break;
+    case REBOOT:
+        NVIC_APINT_R = (0x05FA0000 | NVIC_APINT_SYSRESETREQ);
+        break;
+    case PID:
+        // One important thing to check for are all the pointers by the user. They have to
+        // be within the region of the user task.
+        {
+        uint32_t* pid = (uint32_t*)*(psp);
+        char* taskName = (char*)*(psp + 1);
+        uint8_t p = 0;
+        for(; p < MAX_TASKS; p++)
+            if(tcb[p].state != STATE_INVALID && stringCompare(tcb[p].name, taskName, 16))
+            {
+                // Validate pid if name found
+                *pid = (uint32_t)tcb[p].pid;
+                break;
+            }
+        }
+        break;
+    case KILL:
+        destroyThread((_fn)*psp);
+        // A task that kills itself must not keep running on the stack it just gave back
+        if(tcb[taskCurrent].state == STATE_KILLED)
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+        break;
+    case RESUME:
+        // Restarts the thread.
+        // This seems redundant as we can easily change the state of the task here. The
+        // problem is that we need code on the user side which can also restart threads.
+        // The svc isr is not accessible by user space, so an auxiliary restart function
+        // is required.
+        {
+        char* taskName = (char*)*psp;
+        uint8_t p = 0;
+        for(; p < MAX_TASKS; p++)
+            if(stringCompare(tcb[p].name, taskName, 16) && tcb[p].state == STATE_KILLED)
+            {
+                restartThread((_fn)tcb[p].pid);
+                break;
+            }
+        // Set some ERRNO value if p == MAX_TASKS. This implies that the task was never found
+        }
+        break;
+    case IPCS:
+        {
+        struct _semaphoreInformation* arg = (struct _semaphoreInformation*)*psp;
+        uint8_t* siCountPtr = (uint8_t*)*(psp + 1);
+        getIpcsData(arg, siCountPtr);
+        }
+        break;
+    case PS:
+        {
+        struct _taskInfo* arg = (struct _taskInfo*)*psp;
+        uint8_t* tiCountPtr = (uint8_t*)*(psp + 1);
+        getPsInfo(arg, tiCountPtr);
+        }
+        break;
+    case ALLOCATE_MEMORY:
+        // Function signature: void* allocateMemory(uint32_t bytes)
+        {
+        uint8_t a = 0;
+        while(a < MAX_ALLOCATIONS && allocations[a].base != 0)
+            a++;
+        uint32_t base = (a < MAX_ALLOCATIONS) ? allocateBlocks(*psp) : 0;
+        if(base != 0)
+        {
+            allocations[a].base = (void*)base;
+            allocations[a].size = roundUp(*psp, SUBREGION_SIZE);
+            allocations[a].owner = taskCurrent;
+            tcb[taskCurrent].srd |= getSrdBits(base, allocations[a].size);
+            // The task keeps running, so it needs access right away
+            setSrdBits(tcb[taskCurrent].srd);
+        }
+        *psp = base;
+        }
+        break;
+    case FREE_MEMORY:
+        // Function signature: bool freeMemory(void* p)
+        {
+        uint8_t a = 0;
+        while(a < MAX_ALLOCATIONS && !(allocations[a].base == (void*)*psp && allocations[a].owner == taskCurrent))
+            a++;
+        if(*psp == 0 || a == MAX_ALLOCATIONS)
+        {
+            *psp = false;
+            break;
+        }
+        releaseAllocation(a);
+        setSrdBits(tcb[taskCurrent].srd);
+        *psp = true;
+        }
+        break;
+    case HEAP_STATS:
+        // Function signature: void heapStats(heapInfo* hi)
+        getHeapInfo((struct _heapInformation*)*psp);
+        break;
+    case POOL_OPEN:
+        // Function signature: int8_t poolOpen(const char name[])
+        *psp = findPool((const char*)*psp);
+        break;
+    case POOL_ALLOC:
+        // Function signature: void* poolAlloc(int8_t pool, uint32_t ticks)
+        {
+        if(!isPool(*psp))
+        {
+            *psp = 0;
+            break;
+        }
+        pool* p = &blockPools[*psp];
+        uint32_t ticks = *(psp + 1);
+        uint32_t block = allocatePoolBlock(p);
+        if(block != 0)
+        {
+            *psp = block;
+            if(++p->used > p->highWater)
+                p->highWater = p->used;
+        }
+        else if(ticks == 0)
+            *psp = 0;
+        else
+        {
+            addToWaitQueueByPriority(&p->waiting, taskCurrent);
+            if(ticks != WAIT_FOREVER)
+            {
+                tcb[taskCurrent].ticks = ticks;
+                tcb[taskCurrent].timedWait = true;
+            }
+            blockCurrentTask(BLOCKED_ON_POOL);
+        }
+        }
+        break;
+    case POOL_FREE:
+        // Function signature: bool poolFree(int8_t pool, void* block)
+        {
+        if(!isPool(*psp) || !isPoolBlock(&blockPools[*psp], *(psp + 1)))
+        {
+            *psp = false;
+            break;
+        }
+        pool* p = &blockPools[*psp];
+        uint32_t block = *(psp + 1);
+        // A waiting task gets the block directly, so it stays counted as used
+        if(p->waiting.head != -1)
+            wakeTask(p->waiting.head, block);
+        else
+        {
+            freePoolBlock(p, block);
+            p->used--;
+        }
+        *psp = true;
         }
         break;
-    case POST:
-        // Increment the count for the selected semaphore
-        semaphores[*psp].count++;
-        // If the current count of the semaphore is 1, then it suggests that a task is waiting in
-        // the queue to be waken up.
-        if(semaphores[*psp].count == 1 && semaphores[*psp].queueSize > 0)
+    case SHM_OPEN:
+        // Function signature: void* shmOpen(const char name[])
         {
-            uint8_t currentTaskInSemaphoreQueue = semaphores[*psp].processQueue[0];
-            semaphores[*psp].count--;
-            tcb[currentTaskInSemaphoreQueue].state = STATE_READY;
-            // Delete the task from the semaphore queue
-            uint8_t i = 0;
-            for(; i < semaphores[*psp].queueSize - 1; i++)
-                semaphores[*psp].processQueue[i] = semaphores[*psp].processQueue[i + 1];
-            semaphores[*psp].queueSize--;
+        int8_t m = findSharedMemory((const char*)*psp);
+        *psp = (m != -1 && (sharedMemories[m].members & (1 << taskCurrent))) ? (uint32_t)sharedMemories[m].base : 0;
         }
         break;
-    case SCHED:
-        // Function signature: void sched(bool prioOn)
-        schedulerIdCurrent = ((bool)*psp) ? PRIORITY : ROUND_ROBIN;
-        break;
-    case PREEMPT_MODE:
-        preemption = ((bool)*psp) ? true : false;
+    case MEM_INFO:
+        // Function signature: void memInfo(memoryInfo* mi)
+        getMemoryInfo((struct _memoryInformation*)*psp);
         break;
-    case REBOOT:
-        NVIC_APINT_R = (0x05FA0000 | NVIC_APINT_SYSRESETREQ);
+    case POOLS:
+        // Function signature: void pools(poolInfo* pi, uint8_t* piCount)
+        getPoolsInfo((struct _poolInformation*)*psp, (uint8_t*)*(psp + 1));
         break;
-    case PID:
-        // One important thing to check for are all the pointers by the user. They have to
-        // be within the region of the user task.
+    case SEND_BUFFER:
+        // Function signature: bool sendBuffer(uint32_t pid, void* buffer)
+        // Ownership moves by clearing the subregions from the sender's srd mask and
+        // setting them in the receiver's. The data itself never moves.
         {
-        uint32_t* pid = (uint32_t*)*(psp);
-        char* taskName = (char*)*(psp + 1);
-        uint8_t p = 0;
-        for(; p < taskCount; p++)
-            if(stringCompare(tcb[p].name, taskName, 16))
-            {
-                // Validate pid if name found
-                *pid = (uint32_t)tcb[p].pid;
+        int8_t r = findTask(*psp);
+        uint8_t b = 0;
+        for(; b < MAX_BUFFERS; b++)
+            if((uint32_t)buffers[b].base == *(psp + 1) && buffers[b].owner == taskCurrent)
                 break;
-            }
+        if(r == -1 || r == taskCurrent || b == MAX_BUFFERS)
+        {
+            *psp = false;
+            break;
+        }
+
+        tcb[taskCurrent].srd &= ~buffers[b].srd;
+        tcb[r].srd |= buffers[b].srd;
+        buffers[b].owner = r;
+        // The sender loses access right away
+        setSrdBits(tcb[taskCurrent].srd);
+
+        if(tcb[r].state == STATE_BLOCKED && tcb[r].blockedOn == BLOCKED_ON_BUFFER)
+        {
+            // The receiver is already waiting, so hand over the buffer through its stacked R0.
+            // R0 still holds the size pointer the receiver passed in.
+            uint32_t* size = (uint32_t*)*((uint32_t*)tcb[r].sp + OFFSET_TO_R0_FROM_SAVED_SP);
+            if(size != 0)
+                *size = buffers[b].size;
+            wakeTask(r, (uint32_t)buffers[b].base);
+        }
+        else
+            buffers[b].pending = true;
+        *psp = true;
         }
         break;
-    case KILL:
-        destroyThread((_fn)*psp);
+    case RECEIVE_BUFFER:
+        // Function signature: void* receiveBuffer(uint32_t* size)
+        {
+        uint8_t b = 0;
+        for(; b < MAX_BUFFERS; b++)
+            if(buffers[b].owner == taskCurrent && buffers[b].pending)
+                break;
+        if(b < MAX_BUFFERS)
+        {
+            uint32_t* size = (uint32_t*)*psp;
+            buffers[b].pending = false;
+            if(size != 0)
+                *size = buffers[b].size;
+            *psp = (uint32_t)buffers[b].base;
+        }
+        else
+        {
+            // Nothing has been handed over yet, so block until a sender shows up
+            blockCurrentTask(BLOCKED_ON_BUFFER);
+        }
+        }
         break;
-    case RESUME:
-        // Restarts the thread.
-        // This seems redundant as we can easily change the state of the task here. The
-        // problem is that we need code on the user side which can also restart threads.
-        // The svc isr is not accessible by user space, so an auxiliary restart function
-        // is required.
+
+    // IMPORTANT: *psp is the event group index for all the event flag calls.
+    // They return 0 without blocking if the group is not valid.
+
+    case SET_EVENT_FLAGS:
+        // Function signature: uint32_t setEventFlags(uint8_t group, uint32_t flags)
+        // Every waiter is checked against the new flags in a single pass over the queue.
+        // Flags consumed by EVENT_CLEAR_ON_EXIT waiters are only cleared after the pass,
+        // so all the waiters see the same set of flags.
         {
-        char* taskName = (char*)*psp;
-        uint8_t p = 0;
-        for(; p < taskCount; p++)
-            if(stringCompare(tcb[p].name, taskName, 16) && tcb[p].state == STATE_KILLED)
+        if(*psp >= MAX_EVENT_GROUPS)
+        {
+            *psp = 0;
+            break;
+        }
+        eventGroup* g = &eventGroups[*psp];
+        uint32_t clear = 0;
+        int8_t t = g->waiting.head;
+        g->flags |= *(psp + 1);
+        while(t != -1)
+        {
+            int8_t next = tcb[t].next;
+            if(eventFlagsSatisfied(g->flags, tcb[t].eventFlags, tcb[t].eventOptions))
             {
-                restartThread((_fn)tcb[p].pid);
-                break;
+                if(tcb[t].eventOptions & EVENT_CLEAR_ON_EXIT)
+                    clear |= tcb[t].eventFlags;
+                wakeTask(t, g->flags);
             }
-        // Set some ERRNO value if p == taskCount. This implies that the task was never found
+            t = next;
+        }
+        g->flags &= ~clear;
+        *psp = g->flags;
+        wakeSelectors();
         }
         break;
-    case IPCS:
+    case CLEAR_EVENT_FLAGS:
+        // Function signature: uint32_t clearEventFlags(uint8_t group, uint32_t flags)
         {
-        struct _semaphoreInformation* arg = (struct _semaphoreInformation*)*psp;
-        getIpcsData(arg);
+        if(*psp >= MAX_EVENT_GROUPS)
+        {
+            *psp = 0;
+            break;
+        }
+        eventGroup* g = &eventGroups[*psp];
+        uint32_t flags = g->flags;
+        g->flags &= ~*(psp + 1);
+        // Return the flags as they were before clearing them
+        *psp = flags;
         }
         break;
-    case PS:
+    case WAIT_EVENT_FLAGS:
+        // Function signature: uint32_t waitEventFlags(uint8_t group, uint32_t flags, uint8_t options)
         {
-        struct _taskInfo* arg = (struct _taskInfo*)*psp;
-        uint8_t* tiCountPtr = (uint8_t*)*(psp + 1);
-        getPsInfo(arg, tiCountPtr);
+        if(*psp >= MAX_EVENT_GROUPS)
+        {
+            *psp = 0;
+            break;
+        }
+        eventGroup* g = &eventGroups[*psp];
+        uint32_t wanted = *(psp + 1);
+        uint8_t options = (uint8_t)*(psp + 2);
+        if(eventFlagsSatisfied(g->flags, wanted, options))
+        {
+            *psp = g->flags;
+            if(options & EVENT_CLEAR_ON_EXIT)
+                g->flags &= ~wanted;
+        }
+        else
+        {
+            tcb[taskCurrent].eventFlags = wanted;
+            tcb[taskCurrent].eventOptions = options;
+            addToWaitQueue(&g->waiting, taskCurrent);
+            blockCurrentTask(BLOCKED_ON_EVENT);
+        }
         }
         break;
     }
@@ -388,6 +1769,15 @@ void MPUFaultHandler()
     else
         putsUart0("Fault address not valid.\n");
 
+    // The hardware stacking the registers for an exception also faults in the guard
+    if((NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_MSTKE) ||
+       ((NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_MMARV) && isInStackGuard(taskCurrent, faultAddress)))
+    {
+        putsUart0("Stack overflow in ");
+        putsUart0(tcb[taskCurrent].name);
+        putcUart0('\n');
+    }
+
     // Process stack dump
     putsUart0("\nStack Dump\n-----------------\n  R0 = 0x");
     printUint32InHex(*(psp));
@@ -437,7 +1827,7 @@ void PendSVISR()
     // Check if it's an instruction error or a data error
     if(NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_IERR)
     {
-        tcb[taskCurrent].state = STATE_KILLED;
+        destroyThread((_fn)tcb[taskCurrent].pid);
         // Clear instruction access violation
         NVIC_FAULT_STAT_R |= NVIC_FAULT_STAT_IERR;
         putsUart0("IERR, called from MPU\n\n");
@@ -445,12 +1835,20 @@ void PendSVISR()
 
     if(NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_DERR)
     {
-        tcb[taskCurrent].state = STATE_KILLED;
+        destroyThread((_fn)tcb[taskCurrent].pid);
         // Clear data access violation
         NVIC_FAULT_STAT_R |= NVIC_FAULT_STAT_DERR;
         putsUart0("\nDERR, called from MPU\n\n");
     }
 
+    if(NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_MSTKE)
+    {
+        destroyThread((_fn)tcb[taskCurrent].pid);
+        // Clear stacking access violation
+        NVIC_FAULT_STAT_R |= NVIC_FAULT_STAT_MSTKE;
+        putsUart0("\nMSTKE, called from MPU\n\n");
+    }
+
     // Save the context of the current task
     // Push R4 - R11
     // When a function gets called, it's understood that the function is free
@@ -478,6 +1876,10 @@ void PendSVISR()
     // Reset the timer for calculating a new time interval
     TIMER1_TAV_R = 0xFFFFFFFF;
 
+    // The context of the current task is saved, so requests queued by ISRs can now wake
+    // up any task, including this one, before the scheduler picks the next task
+    processDeferredRequests();
+
     // Get a new task to run
     switch(schedulerIdCurrent)
     {
@@ -490,6 +1892,8 @@ void PendSVISR()
     }
 
     setSrdBits(tcb[taskCurrent].srd);
+    setSmallStackRegion((uint32_t)tcb[taskCurrent].stackBase, tcb[taskCurrent].stackBytes);
+    setStackGuard((uint32_t)tcb[taskCurrent].stackBase);
 
     taskStartTime = TIMER1_TAV_R;
 
@@ -599,15 +2003,75 @@ void initRtos()
         tcb[i].state = STATE_INVALID;
         tcb[i].pid = 0;
     }
+    // no buffers handed out
+    for (i = 0; i < MAX_BUFFERS; i++)
+    {
+        buffers[i].base = 0;
+        buffers[i].owner = -1;
+        buffers[i].pending = false;
+    }
+    for (i = 0; i < MAX_SEMAPHORES; i++)
+    {
+        semaphores[i].inUse = false;
+        initWaitQueue(&semaphores[i].waiting);
+    }
+    for (i = 0; i < MAX_ALLOCATIONS; i++)
+        allocations[i].base = 0;
+    for (i = 0; i < MAX_SHARED_MEMORY; i++)
+        sharedMemories[i].inUse = false;
+    for (i = 0; i < MAX_POOLS; i++)
+    {
+        blockPools[i].inUse = false;
+        initWaitQueue(&blockPools[i].waiting);
+    }
+    for (i = 0; i < MAX_BARRIERS; i++)
+    {
+        barriers[i].inUse = false;
+        initWaitQueue(&barriers[i].waiting);
+    }
+    for (i = 0; i < MAX_PIPES; i++)
+    {
+        pipes[i].inUse = false;
+        initWaitQueue(&pipes[i].readersWaiting);
+        initWaitQueue(&pipes[i].writersWaiting);
+    }
+    for (i = 0; i < MAX_MUTEXES; i++)
+    {
+        mutexes[i].inUse = false;
+        initWaitQueue(&mutexes[i].waiting);
+    }
+    for (i = 0; i < MAX_CONDITIONS; i++)
+    {
+        conditions[i].inUse = false;
+        initWaitQueue(&conditions[i].waiting);
+    }
+    for (i = 0; i < MAX_RWLOCKS; i++)
+    {
+        rwLocks[i].inUse = false;
+        initWaitQueue(&rwLocks[i].readersWaiting);
+        initWaitQueue(&rwLocks[i].writersWaiting);
+    }
+    for (i = 0; i < MAX_EVENT_GROUPS; i++)
+    {
+        eventGroups[i].flags = 0;
+        initWaitQueue(&eventGroups[i].waiting);
+    }
+
+    // Thread stacks, buffers, pools and allocations are handed out from the whole blocks
+    // of the task arena. The rest of the SRAM is the kernel's.
+    uint32_t block = roundUp((uint32_t)&__task_arena_start, SUBREGION_SIZE);
+    blocksInUse = 0xFFFFFFFF;
+    for(; block + SUBREGION_SIZE <= (uint32_t)&__task_arena_end; block += SUBREGION_SIZE)
+        blocksInUse &= ~getSrdBits(block, SUBREGION_SIZE);
 
     // Enable the MPU
     enableBackgroundRegionRule();
     enableFlashRule();
 
-    enableSRAMRule(SRAM_REGION_0, SIZE_8KIB, REGION_2);
-    enableSRAMRule(SRAM_REGION_1, SIZE_8KIB, REGION_3);
-    enableSRAMRule(SRAM_REGION_2, SIZE_8KIB, REGION_4);
-    enableSRAMRule(SRAM_REGION_3, SIZE_8KIB, REGION_5);
+    // Regions 2 - 5 cover the SRAM in 8KiB pieces. Only privileged code can access it,
+    // until the srd of a task disables the subregions of the blocks it owns.
+    for(i = 0; i < 4; i++)
+        enableSRAMRule(SRAM_BASE + i * SRAM_REGION_SIZE, SIZE_8KIB, REGION_2 + i);
 
     enableMPU();
 }
@@ -618,13 +2082,16 @@ void initRtos()
 int rtosScheduler()
 {
     bool ok;
-    static uint8_t task = 0xFF;
+    static uint8_t n = 0xFF;
+    uint8_t task;
     ok = false;
+    // Only the live tasks are visited, killed tasks are not in the list
     while (!ok)
     {
-        task++;
-        if (task >= MAX_TASKS)
-            task = 0;
+        n++;
+        if (n >= taskCount)
+            n = 0;
+        task = liveTasks[n];
         ok = (tcb[task].state == STATE_READY || tcb[task].state == STATE_UNRUN);
     }
     return task;
@@ -647,12 +2114,53 @@ void initTaskNextPriorities()
     uint8_t j = 0;
     // The max priority level is 7
     for(priority = 0; priority <= 7; priority++)
-        for(j = 0; j < taskCount && j < MAX_TASKS; j++)
-            if(tcb[j].priority == priority)
-                priNextTask[level++] = j;
+        for(j = 0; j < taskCount; j++)
+            if(tcb[liveTasks[j]].priority == priority)
+                priNextTask[level++] = liveTasks[j];
     level = 0;
 }
 
+// Adds the task to the tasks the schedulers pick from
+static void addLiveTask(uint8_t task)
+{
+    uint8_t n = taskCount;
+    for(; n > 0 && liveTasks[n - 1] > task; n--)
+        liveTasks[n] = liveTasks[n - 1];
+    liveTasks[n] = task;
+    taskCount++;
+    initTaskNextPriorities();
+}
+
+static void removeLiveTask(uint8_t task)
+{
+    uint8_t n = 0;
+    while(n < taskCount && liveTasks[n] != task)
+        n++;
+    if(n == taskCount)
+        return;
+    for(taskCount--; n < taskCount; n++)
+        liveTasks[n] = liveTasks[n + 1];
+    initTaskNextPriorities();
+}
+
+// Releases what a killed task kept for when it is resumed, so that its slot can be reused
+static void forgetThread(uint8_t task)
+{
+    uint8_t l = 0;
+    for(; l < MAX_BUFFERS; l++)
+        if(buffers[l].base != 0 && buffers[l].owner == task)
+        {
+            freeBlocks((uint32_t)buffers[l].base, buffers[l].size);
+            buffers[l].base = 0;
+            buffers[l].owner = -1;
+            buffers[l].pending = false;
+        }
+    for(l = 0; l < MAX_SHARED_MEMORY; l++)
+        sharedMemories[l].members &= ~(1 << task);
+    tcb[task].state = STATE_INVALID;
+    tcb[task].pid = 0;
+}
+
 int priorityRtosScheduler()
 {
     bool ok = false;
@@ -666,59 +2174,53 @@ int priorityRtosScheduler()
     return priNextTask[level - 1];
 }
 
-// Reference: https://stackoverflow.com/questions/3407012/rounding-up-to-the-nearest-multiple-of-a-number
-uint32_t roundUp(uint32_t numToRound, uint32_t multiple)
-{
-    return ((numToRound + multiple - 1) / multiple) * multiple;
-}
-
 bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
 {
     bool ok = false;
     uint8_t i = 0;
     bool found = false;
+    uint32_t bytes = getStackReservation(stackBytes);
+    uint32_t base;
     // REQUIRED:
     // store the thread name
     // allocate stack space and store top of stack in sp and spInit
     // add task if room in task list
     if (taskCount < MAX_TASKS)
     {
-        // make sure fn not already in list (prevent reentrancy)
-        while (!found && (i < MAX_TASKS))
+        // make sure fn not already running (prevent reentrancy)
+        found = (findTask((uint32_t)fn) != -1);
+        // A killed task keeps its slot, so that it can be resumed. Creating the same
+        // function again takes the slot back. Otherwise the first available tcb record
+        // is used, and a killed task is only forgotten when none is left.
+        while (i < MAX_TASKS && !(tcb[i].state == STATE_KILLED && tcb[i].pid == fn)) { i++; }
+        if (i == MAX_TASKS)
+            for (i = 0; i < MAX_TASKS && tcb[i].state != STATE_INVALID; i++);
+        if (i == MAX_TASKS)
+            for (i = 0; tcb[i].state != STATE_KILLED; i++);
+        // The stack is taken first, so that a killed task is only forgotten once its
+        // slot is sure to be reused
+        base = found ? 0 : takeStack(bytes);
+        if (base != 0)
         {
-            found = (tcb[i++].pid == fn);
-        }
-        if (!found)
-        {
-            // find first available tcb record
-            i = 0;
-            while (tcb[i].state != STATE_INVALID) { i++; }
+            if (tcb[i].state == STATE_KILLED)
+                forgetThread(i);
+            // During creation, the current stack pointer == the initial stack pointer
+            tcb[i].stackBytes = bytes;
+            tcb[i].srd = 0;
+            setStack(i, base);
             tcb[i].state = STATE_UNRUN;
             tcb[i].pid = fn;
-            // During creation, the current stack pointer == the initial stack pointer
-            // We need to know how many 1KiB blocks we need. We can get it from the number of SRD bits.
-            // Number of SRD bits = stackBytes / 1KiB = ((stackBytes - 1) / 1024) + 1
-            uint8_t nSrd = ((stackBytes - 1) / 0x400) + 1;
-            // If it is the first task, the base is just the heap
-            // Otherwise, get the previous sp and treat that as the base
-            // tmp currently stores the base address to use
-            uint32_t tmp = (i == 0) ? (uint32_t)heap : (uint32_t)tcb[i - 1].spInit;
-            // Base + (Number of 1KiB blocks * 1KiB)
-            tcb[i].sp = (void*)(tmp + (nSrd * 0x400) - 1);
-            tcb[i].spInit = (void*)(tmp + (nSrd * 0x400) - 1);
             tcb[i].priority = priority;
-            tcb[i].srd = 0;
-            // Sets all required SRD bits
-            while((tcb[i].srd |= 1) && --nSrd && (tcb[i].srd <<= 1));
-            // Put the SRD bits in the correct bit positions
-            // Find the offset to the end of the stack space for a thread
-            // That is where the SRD bit for that thread begins
-            tcb[i].srd <<= ((uint32_t)tcb[i].spInit - roundUp(stackBytes, 1024)) / 0x400 + 1;
             tcb[i].time = 0;
             stringCopy(name, tcb[i].name, 16);
-            tcb[i].semaphore = 0;
+            tcb[i].blockedOn = BLOCKED_ON_NONE;
+            tcb[i].timedWait = false;
+            tcb[i].notifyValue = 0;
+            tcb[i].queue = 0;
+            tcb[i].prev = -1;
+            tcb[i].next = -1;
             // increment task count
-            taskCount++;
+            addLiveTask(i);
             ok = true;
         }
     }
@@ -727,52 +2229,79 @@ bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackByt
 }
 
 // REQUIRED: modify this function to restart a thread
-void restartThread(_fn fn)
+// The stack was given back when the thread was killed, so it needs a new one.
+// Returns false if the thread was not killed or there is not enough free SRAM left for it.
+bool restartThread(_fn fn)
 {
     uint8_t i = 0;
-    for(; i < taskCount; i++)
-        if(tcb[i].pid == fn)
+    for(; i < MAX_TASKS; i++)
+        if(tcb[i].state == STATE_KILLED && tcb[i].pid == fn)
         {
-            tcb[i].sp = tcb[i].spInit;
+            if(!allocateStack(i))
+                return false;
+            tcb[i].time = 0;
+            tcb[i].notifyValue = 0;
             tcb[i].state = STATE_UNRUN;
-            break;
+            addLiveTask(i);
+            return true;
         }
+    return false;
 }
 
 // REQUIRED: modify this function to destroy a thread
 // REQUIRED: remove any pending semaphore waiting
 // NOTE: see notes in class for strategies on whether stack is freed or not
+// The slot is kept with the name and priority of the task, so that it can be resumed.
+// Its buffers and shared memory stay mapped until then, everything else is given back.
 void destroyThread(_fn fn)
 {
-    uint8_t i = 0;
-    for(; i < taskCount; i++)
-        if(tcb[i].pid == fn)
+    int8_t i = findTask((uint32_t)fn);
+    if(i == -1)
+        return;
+    // Unlink the task from the semaphore or event group it is waiting on
+    if(tcb[i].state == STATE_BLOCKED)
+    {
+        // A task killed at a barrier no longer counts as arrived
+        uint8_t b = 0;
+        for(; b < MAX_BARRIERS; b++)
+            if(tcb[i].queue == &barriers[b].waiting)
+                barriers[b].arrived--;
+        // A reader or writer at the head of a pipe queue may be holding up the ones behind it
+        pipe* p = 0;
+        for(b = 0; b < MAX_PIPES; b++)
+            if(tcb[i].queue == &pipes[b].readersWaiting || tcb[i].queue == &pipes[b].writersWaiting)
+                p = &pipes[b];
+        removeFromWaitQueue(i);
+        if(p != 0)
+            servicePipe(p);
+    }
+    tcb[i].blockedOn = BLOCKED_ON_NONE;
+    tcb[i].timedWait = false;
+    // A task that gets killed gives up its hold on a reader-writer lock. A writer that was
+    // only waiting may have been keeping readers out, so every lock is serviced.
+    uint8_t l = 0;
+    for(; l < MAX_RWLOCKS; l++)
+        if(rwLocks[l].inUse)
         {
-            semaphore* s = (semaphore*)tcb[i].semaphore;
-            // Remove information from the semaphore array
-            if(tcb[i].semaphore != 0 && tcb[i].state == STATE_BLOCKED)
-            {
-                uint8_t sCounter = 0;
-                for(; sCounter < s->queueSize; sCounter++)
-                    if(s->processQueue[sCounter] == i)
-                    {
-                        // Since I am removing a semaphore, I just named the counter r
-                        // Shift all the elements back by 1 index to delete task
-                        int8_t r = sCounter;
-                        for(; r < s->queueSize - 1; r++)
-                        {
-                            s->processQueue[r] = s->processQueue[r + 1];
-                            s->queueSize--;
-                        }
-                        s->processQueue[r] = 0;
-                        // Decrement the queue size manually as the last element remaining is null
-                        if(s->queueSize == 1)
-                            s->queueSize = 0;
-                    }
-            }
-            tcb[i].state = STATE_KILLED;
-            break;
+            if(rwLocks[l].writer == i)
+                rwLocks[l].writer = -1;
+            rwLocks[l].readers &= ~(1 << i);
+            serviceRwLock(&rwLocks[l]);
         }
+    // and so does the owner of a mutex
+    for(l = 0; l < MAX_MUTEXES; l++)
+        if(mutexes[l].inUse && mutexes[l].owner == i)
+            releaseMutex(&mutexes[l]);
+    // The blocks can be handed out again as soon as the task is switched out.
+    // Nothing allocates until then, so saving its context is still safe.
+    freeStack(i);
+    for(l = 0; l < MAX_ALLOCATIONS; l++)
+        if(allocations[l].base != 0 && allocations[l].owner == i)
+            releaseAllocation(l);
+    tcb[i].state = STATE_KILLED;
+    cpuUsageTime[i] = 0;
+    // The schedulers no longer visit it
+    removeLiveTask(i);
 }
 
 // REQUIRED: modify this function to set a thread priority
@@ -781,49 +2310,434 @@ void setThreadPriority(_fn fn, uint8_t priority)
 }
 
 // This is very implementation specific
-void getIpcsData(struct _semaphoreInformation* si)
+// Only the semaphores that currently exist are copied over
+void getIpcsData(struct _semaphoreInformation* si, uint8_t* siCount)
 {
     uint8_t i = 0;
+    uint8_t n = 0;
     for(; i < MAX_SEMAPHORES; i++)
     {
-        si[i].count = semaphores[i].count;
-        si[i].waitingTasksNumber = semaphores[i].queueSize;
+        if(!semaphores[i].inUse)
+            continue;
+        stringCopy(semaphores[i].name, si[n].name, MAX_SEM_NAME - 1);
+        si[n].count = semaphores[i].count;
+        // Only the first few waiters fit in the user space struct
         uint8_t j = 0;
-        for(; j < semaphores[i].queueSize; j++)
-            si[i].waitQueue[j] = semaphores[i].processQueue[j];
+        int8_t t = semaphores[i].waiting.head;
+        for(; t != -1 && j < MAX_SEM_WAIT_QUEUE_SIZE; j++, t = tcb[t].next)
+            si[n].waitQueue[j] = t;
+        si[n].waitingTasksNumber = j;
+        n++;
     }
-
-    // This does not need to be copied over every time. This should be changed so that
-    // the names are persistent instead of being copied over and over again.
-    stringCopy("null", si[0].name, 16);
-    stringCopy("keyPressed", si[1].name, 16);
-    stringCopy("keyReleased", si[2].name, 16);
-    stringCopy("flashReq", si[3].name, 16);
-    stringCopy("resource", si[4].name, 16);
+    *siCount = n;
 }
 
+// Killed tasks are listed too, so that they can be found and resumed
 void getPsInfo(struct _taskInfo* ti, uint8_t* tiCount)
 {
     uint8_t i = 0;
-    for(; i < taskCount; i++)
+    uint8_t n = 0;
+    for(; i < MAX_TASKS; i++)
+    {
+        if(tcb[i].state == STATE_INVALID)
+            continue;
+        stringCopy(tcb[i].name, ti[n].name, 16);
+        ti[n].pid = (uint32_t)tcb[i].pid;
+        ti[n].state = tcb[i].state;
+        ti[n].time = cpuUsageTime[i];
+        ti[n].stackBytes = (tcb[i].stackBase != 0) ? tcb[i].stackBytes : 0;
+        ti[n].stackUsed = getStackUsed(i);
+        n++;
+    }
+    *tiCount = n;
+}
+
+void getHeapInfo(struct _heapInformation* hi)
+{
+    uint8_t i = 0;
+    uint32_t run = 0;
+    hi->allocations = 0;
+    hi->allocatedBytes = 0;
+    hi->freeBytes = 0;
+    hi->largestFreeBytes = 0;
+    for(; i < MAX_ALLOCATIONS; i++)
+        if(allocations[i].base != 0)
+        {
+            hi->allocations++;
+            hi->allocatedBytes += allocations[i].size;
+        }
+    // Free blocks that are not next to each other can not be handed out together
+    for(i = 0; i < 32; i++)
+    {
+        if(blocksInUse & (1 << i))
+            run = 0;
+        else
+        {
+            run += SUBREGION_SIZE;
+            hi->freeBytes += SUBREGION_SIZE;
+            if(run > hi->largestFreeBytes)
+                hi->largestFreeBytes = run;
+        }
+    }
+}
+
+// Marks the blocks of [base, base + bytes) in the map
+static void markMemoryMap(char map[], uint32_t base, uint32_t bytes, char c)
+{
+    uint32_t srd = getSrdBits(base, bytes);
+    uint8_t b = 0;
+    for(; b < 32; b++)
+        if(srd & (1 << b))
+            map[b] = c;
+}
+
+void getMemoryInfo(struct _memoryInformation* mi)
+{
+    uint8_t i = 0;
+    struct _heapInformation hi;
+    mi->sramBase = SRAM_BASE;
+    mi->kernelDataBytes = (uint32_t)&__kernel_data_end - (uint32_t)&__kernel_data_start;
+    mi->kernelStackBytes = (uint32_t)&__kernel_stack_end - (uint32_t)&__kernel_stack_start;
+    mi->arenaBytes = (uint32_t)&__task_arena_end - (uint32_t)&__task_arena_start;
+    getHeapInfo(&hi);
+    mi->freeBytes = hi.freeBytes;
+
+    // Blocks in use that nothing below claims are outside of the arena
+    for(; i < 32; i++)
+        mi->map[i] = (blocksInUse & (1 << i)) ? MEM_MAP_KERNEL : MEM_MAP_FREE;
+    mi->map[32] = '\0';
+    for(i = 0; i < MAX_TASKS; i++)
+        if(tcb[i].stackBase != 0 && tcb[i].stackBytes >= SUBREGION_SIZE)
+            markMemoryMap(mi->map, (uint32_t)tcb[i].stackBase, tcb[i].stackBytes, MEM_MAP_STACK);
+    for(i = 0; i < 32; i++)
+        if(smallStackSlots[i] != 0)
+            mi->map[i] = MEM_MAP_SMALL_STACKS;
+    for(i = 0; i < MAX_BUFFERS; i++)
+        if(buffers[i].base != 0)
+            markMemoryMap(mi->map, (uint32_t)buffers[i].base, buffers[i].size, MEM_MAP_BUFFER);
+    for(i = 0; i < MAX_POOLS; i++)
+        if(blockPools[i].inUse)
+            markMemoryMap(mi->map, (uint32_t)blockPools[i].base,
+                          (uint32_t)blockPools[i].blockSize * blockPools[i].blockCount, MEM_MAP_POOL);
+    for(i = 0; i < MAX_ALLOCATIONS; i++)
+        if(allocations[i].base != 0)
+            markMemoryMap(mi->map, (uint32_t)allocations[i].base, allocations[i].size, MEM_MAP_HEAP);
+    for(i = 0; i < MAX_SHARED_MEMORY; i++)
+        if(sharedMemories[i].inUse)
+            markMemoryMap(mi->map, (uint32_t)sharedMemories[i].base, sharedMemories[i].size, MEM_MAP_SHARED);
+}
+
+void getPoolsInfo(struct _poolInformation* pi, uint8_t* piCount)
+{
+    uint8_t i = 0;
+    uint8_t count = 0;
+    for(; i < MAX_POOLS; i++)
+        if(blockPools[i].inUse)
+        {
+            stringCopy(blockPools[i].name, pi[count].name, MAX_SEM_NAME);
+            pi[count].blockSize = blockPools[i].blockSize;
+            pi[count].blockCount = blockPools[i].blockCount;
+            pi[count].used = blockPools[i].used;
+            pi[count].highWater = blockPools[i].highWater;
+            pi[count].waiting = blockPools[i].waiting.size;
+            count++;
+        }
+    *piCount = count;
+}
+
+// The named kernel objects are arrays of structs that each have a bool inUse and a
+// char name[MAX_SEM_NAME]. NAMED_OBJECTS passes the array and where those two fields are,
+// so that one lookup works for all of them.
+#define NAMED_OBJECTS(objects, count) (uint8_t*)(objects), (count), sizeof((objects)[0]), \
+    (uint8_t*)&(objects)[0].inUse - (uint8_t*)(objects), (uint8_t*)(objects)[0].name - (uint8_t*)(objects)
+
+// Returns the index of the object in use with matching name or -1 if there is none
+static int8_t findNamed(uint8_t* objects, uint8_t count, uint16_t size, uint16_t inUse, uint16_t name,
+                        const char objectName[])
+{
+    int8_t i = 0;
+    for(; i < count; i++, objects += size)
+        if(*(bool*)(objects + inUse) && stringCompare((char*)(objects + name), objectName, MAX_SEM_NAME))
+            return i;
+    return -1;
+}
+
+// Marks the first unused object as in use under the name and returns its index, or -1
+// if there is no free slot or the name is already taken. The caller sets up the rest.
+static int8_t claimNamed(uint8_t* objects, uint8_t count, uint16_t size, uint16_t inUse, uint16_t name,
+                         const char objectName[])
+{
+    int8_t i = 0;
+    if(findNamed(objects, count, size, inUse, name, objectName) != -1)
+        return -1;
+    for(; i < count; i++, objects += size)
+        if(!*(bool*)(objects + inUse))
+        {
+            *(bool*)(objects + inUse) = true;
+            stringCopy(objectName, (char*)(objects + name), MAX_SEM_NAME - 1);
+            return i;
+        }
+    return -1;
+}
+
+// Returns the handle of the new pool or -1 if there is no free slot, the name is taken
+// or there is not enough SRAM. blockSize is rounded up to a multiple of 4.
+// A pool has at most MAX_POOL_BLOCKS blocks.
+int8_t createPool(const char name[], uint16_t blockSize, uint16_t blockCount)
+{
+    if(blockSize == 0 || blockCount == 0 || blockCount > MAX_POOL_BLOCKS)
+        return -1;
+    blockSize = roundUp(blockSize, 4);
+    int8_t i = claimNamed(NAMED_OBJECTS(blockPools, MAX_POOLS), name);
+    if(i == -1)
+        return -1;
+    uint32_t bytes = (uint32_t)blockSize * blockCount;
+    uint32_t base = allocateBlocks(bytes);
+    uint16_t b;
+    if(base == 0)
+    {
+        blockPools[i].inUse = false;
+        return -1;
+    }
+    blockPools[i].base = (void*)base;
+    blockPools[i].blockSize = blockSize;
+    blockPools[i].blockCount = blockCount;
+    blockPools[i].used = 0;
+    blockPools[i].highWater = 0;
+    for(b = 0; b < MAX_POOL_BLOCKS / 32; b++)
+        blockPools[i].allocated[b] = 0;
+    initWaitQueue(&blockPools[i].waiting);
+    poolSrd |= getSrdBits(base, bytes);
+    return i;
+}
+
+// Returns the handle of the pool with matching name or -1 if there is none
+int8_t findPool(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(blockPools, MAX_POOLS), name);
+}
+
+// Returns the handle of the new semaphore or -1 if there is no free slot or the
+// name is already taken
+int8_t createSemaphore(const char name[], uint8_t count)
+{
+    // The name is stored once here and never copied again until ipcs asks for it
+    int8_t i = claimNamed(NAMED_OBJECTS(semaphores, MAX_SEMAPHORES), name);
+    if(i != -1)
+    {
+        semaphores[i].count = count;
+        initWaitQueue(&semaphores[i].waiting);
+    }
+    return i;
+}
+
+// Returns the handle of the semaphore with matching name or -1 if there is none
+int8_t findSemaphore(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(semaphores, MAX_SEMAPHORES), name);
+}
+
+// A semaphore that tasks are still blocked on can not be deleted
+bool deleteSemaphore(int8_t semaphore)
+{
+    if(!isSemaphore(semaphore) || semaphores[semaphore].waiting.size != 0)
+        return false;
+    semaphores[semaphore].inUse = false;
+    return true;
+}
+
+// Creates a buffer owned by the thread fn. The buffer is placed in the thread's mailbox,
+// so the thread gets the address of the buffer by calling receiveBuffer().
+bool createBuffer(_fn fn, uint32_t bytes)
+{
+    int8_t i = findTask((uint32_t)fn);
+    uint8_t b = 0;
+    for(; b < MAX_BUFFERS; b++)
+        if(buffers[b].base == 0)
+            break;
+    if(i == -1 || b == MAX_BUFFERS)
+        return false;
+
+    uint32_t base = allocateBlocks(bytes);
+    if(base == 0)
+        return false;
+
+    buffers[b].base = (void*)base;
+    buffers[b].size = roundUp(bytes, SUBREGION_SIZE);
+    buffers[b].srd = getSrdBits(base, bytes);
+    buffers[b].owner = i;
+    buffers[b].pending = true;
+    tcb[i].srd |= buffers[b].srd;
+    return true;
+}
+
+// Returns the index of the shared memory with matching name or -1 if there is none
+int8_t findSharedMemory(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(sharedMemories, MAX_SHARED_MEMORY), name);
+}
+
+// Creates shared memory that no task can access until it is shared with it.
+// Returns false if there is no free slot, the name is taken or there is not enough SRAM.
+bool createSharedMemory(const char name[], uint32_t bytes)
+{
+    int8_t m = claimNamed(NAMED_OBJECTS(sharedMemories, MAX_SHARED_MEMORY), name);
+    if(m == -1)
+        return false;
+    uint32_t base = allocateBlocks(bytes);
+    if(base == 0)
+    {
+        sharedMemories[m].inUse = false;
+        return false;
+    }
+    sharedMemories[m].base = (void*)base;
+    sharedMemories[m].size = roundUp(bytes, SUBREGION_SIZE);
+    sharedMemories[m].srd = getSrdBits(base, bytes);
+    sharedMemories[m].members = 0;
+    return true;
+}
+
+// Maps the shared memory into the thread fn. Returns false if either does not exist.
+bool shareMemory(const char name[], _fn fn)
+{
+    int8_t m = findSharedMemory(name);
+    int8_t i = findTask((uint32_t)fn);
+    if(m == -1 || i == -1)
+        return false;
+    sharedMemories[m].members |= 1 << i;
+    tcb[i].srd |= sharedMemories[m].srd;
+    return true;
+}
+
+// Returns the handle of the new barrier or -1 if there is no free slot or the name is taken
+int8_t createBarrier(const char name[], uint8_t parties)
+{
+    if(parties == 0)
+        return -1;
+    int8_t i = claimNamed(NAMED_OBJECTS(barriers, MAX_BARRIERS), name);
+    if(i != -1)
+    {
+        barriers[i].parties = parties;
+        barriers[i].arrived = 0;
+        initWaitQueue(&barriers[i].waiting);
+    }
+    return i;
+}
+
+// Returns the handle of the barrier with matching name or -1 if there is none
+int8_t findBarrier(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(barriers, MAX_BARRIERS), name);
+}
+
+// Returns the handle of the new pipe or -1 if there is no free slot or the name is taken.
+// trigger is the number of bytes a reader waits for, between 1 and PIPE_SIZE.
+int8_t createPipe(const char name[], uint16_t trigger)
+{
+    if(trigger == 0 || trigger > PIPE_SIZE)
+        return -1;
+    int8_t i = claimNamed(NAMED_OBJECTS(pipes, MAX_PIPES), name);
+    if(i != -1)
+    {
+        pipes[i].head = 0;
+        pipes[i].tail = 0;
+        pipes[i].count = 0;
+        pipes[i].trigger = trigger;
+        initWaitQueue(&pipes[i].readersWaiting);
+        initWaitQueue(&pipes[i].writersWaiting);
+    }
+    return i;
+}
+
+// Returns the handle of the pipe with matching name or -1 if there is none
+int8_t findPipe(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(pipes, MAX_PIPES), name);
+}
+
+// Returns the handle of the new mutex or -1 if there is no free slot or the name is taken
+int8_t createMutex(const char name[])
+{
+    int8_t i = claimNamed(NAMED_OBJECTS(mutexes, MAX_MUTEXES), name);
+    if(i != -1)
+    {
+        mutexes[i].owner = -1;
+        mutexes[i].depth = 0;
+        initWaitQueue(&mutexes[i].waiting);
+    }
+    return i;
+}
+
+// Returns the handle of the mutex with matching name or -1 if there is none
+int8_t findMutex(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(mutexes, MAX_MUTEXES), name);
+}
+
+// Returns the handle of the new condition or -1 if there is no free slot or the name is taken
+int8_t createCondition(const char name[])
+{
+    int8_t i = claimNamed(NAMED_OBJECTS(conditions, MAX_CONDITIONS), name);
+    if(i != -1)
+        initWaitQueue(&conditions[i].waiting);
+    return i;
+}
+
+// Returns the handle of the condition with matching name or -1 if there is none
+int8_t findCondition(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(conditions, MAX_CONDITIONS), name);
+}
+
+// Returns the handle of the new lock or -1 if there is no free slot or the name is taken
+int8_t createRwLock(const char name[])
+{
+    int8_t i = claimNamed(NAMED_OBJECTS(rwLocks, MAX_RWLOCKS), name);
+    if(i != -1)
     {
-        stringCopy(tcb[i].name, ti[i].name, 16);
-        ti[i].pid = (uint32_t)tcb[i].pid;
-        ti[i].state = tcb[i].state;
-        ti[i].time = cpuUsageTime[i];
+        rwLocks[i].readers = 0;
+        rwLocks[i].writer = -1;
+        initWaitQueue(&rwLocks[i].readersWaiting);
+        initWaitQueue(&rwLocks[i].writersWaiting);
     }
-    *tiCount = taskCount;
+    return i;
+}
+
+// Returns the handle of the lock with matching name or -1 if there is none
+int8_t findRwLock(const char name[])
+{
+    return findNamed(NAMED_OBJECTS(rwLocks, MAX_RWLOCKS), name);
 }
 
-bool createSemaphore(uint8_t semaphore, uint8_t count)
+bool createEventGroup(uint8_t group)
 {
-    bool ok = (semaphore < MAX_SEMAPHORES);
+    bool ok = (group < MAX_EVENT_GROUPS);
+    if(ok)
     {
-        semaphores[semaphore].count = count;
+        eventGroups[group].flags = 0;
+        initWaitQueue(&eventGroups[group].waiting);
     }
     return ok;
 }
 
+// These can be called from any ISR. They queue the request and return right away;
+// the kernel applies it in PendSV or on the next systick. They return false if the
+// queue is full and the request was dropped.
+bool postFromIsr(int8_t semaphore)
+{
+    return deferRequest(DEFERRED_POST, (uint32_t)semaphore, 0);
+}
+
+bool notifyGiveFromIsr(uint32_t pid)
+{
+    return deferRequest(DEFERRED_NOTIFY_GIVE, pid, 0);
+}
+
+bool notifySetBitsFromIsr(uint32_t pid, uint32_t bits)
+{
+    return deferRequest(DEFERRED_NOTIFY_SET_BITS, pid, bits);
+}
+
 // REQUIRED: modify this function to start the operating system
 // by calling scheduler, setting PSP, ASP bit, and PC
 void startRtos()
@@ -847,6 +2761,8 @@ void startRtos()
     // Mark the task as ready because we are going to run it
     tcb[taskCurrent].state = STATE_READY;
     setSrdBits(tcb[taskCurrent].srd);
+    setSmallStackRegion((uint32_t)tcb[taskCurrent].stackBase, tcb[taskCurrent].stackBytes);
+    setStackGuard((uint32_t)tcb[taskCurrent].stackBase);
     disablePrivilegeMode();
     fn();
 }
@@ -861,9 +2777,11 @@ void infoTcb()
         return;
     }
 
-    uint8_t i = 0;
-    for(; i < taskCount; i++)
+    uint8_t n = 0;
+    uint8_t i;
+    for(; n < taskCount; n++)
     {
+        i = liveTasks[n];
         putsUart0("\nProcess ");
         putsUart0(tcb[i].name);
         putsUart0(" is ");
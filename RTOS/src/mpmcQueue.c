@@ -0,0 +1,106 @@
+/*
+ * mpmcQueue.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#include "mpmcQueue.h"
+#include "atomic.h"
+#include "syscalls.h"
+
+// size is the number of cells and has to be a power of 2. semaphore is the kernel
+// semaphore consumers block on, created with a count of 0.
+bool mpmcQueueInit(mpmcQueue* q, mpmcCell* cells, uint32_t size, int8_t semaphore)
+{
+    uint32_t i = 0;
+    if(size == 0 || (size & (size - 1)) != 0)
+        return false;
+    // Cell i is free for the producer that claims position i
+    for(; i < size; i++)
+        cells[i].sequence = i;
+    q->enqueuePosition = 0;
+    q->dequeuePosition = 0;
+    q->mask = size - 1;
+    q->cells = cells;
+    fastSemaphoreInit(&q->values, 0, semaphore);
+    return true;
+}
+
+// Producer side, can be called from any number of tasks. Returns false if the queue is full.
+bool mpmcQueuePush(mpmcQueue* q, uint32_t value)
+{
+    mpmcCell* cell;
+    int32_t difference;
+    uint32_t position = q->enqueuePosition;
+    while(true)
+    {
+        cell = &q->cells[position & q->mask];
+        difference = (int32_t)(cell->sequence - position);
+        // The cell is free for this position, try to claim it
+        if(difference == 0)
+        {
+            if(atomicCompareExchange(&q->enqueuePosition, position, position + 1))
+                break;
+            position = q->enqueuePosition;
+        }
+        // The cell still holds the value from one lap ago
+        else if(difference < 0)
+            return false;
+        // Another producer claimed the position first
+        else
+            position = q->enqueuePosition;
+    }
+    cell->value = value;
+    // The value has to be visible before the sequence number that publishes it
+    dataMemoryBarrier();
+    cell->sequence = position + 1;
+    fastPost(&q->values);
+    return true;
+}
+
+// Takes the value at the head of the queue. The caller already holds a unit of the
+// values semaphore, so a value has been published. The cell at the head may still
+// belong to a producer that claimed it before the one that posted and has not written
+// it yet, in which case the consumer lets it run and tries again.
+static uint32_t dequeue(mpmcQueue* q)
+{
+    mpmcCell* cell;
+    int32_t difference;
+    uint32_t value;
+    uint32_t position = q->dequeuePosition;
+    while(true)
+    {
+        cell = &q->cells[position & q->mask];
+        difference = (int32_t)(cell->sequence - (position + 1));
+        if(difference == 0)
+        {
+            if(atomicCompareExchange(&q->dequeuePosition, position, position + 1))
+                break;
+        }
+        else if(difference < 0)
+            yield();
+        position = q->dequeuePosition;
+    }
+    value = cell->value;
+    // The value has to be read before the cell is handed back to the producers
+    dataMemoryBarrier();
+    cell->sequence = position + q->mask + 1;
+    return value;
+}
+
+// Consumer side, can be called from any number of tasks. Returns false if the queue is empty.
+bool mpmcQueueTryPop(mpmcQueue* q, uint32_t* value)
+{
+    if(!fastTryWait(&q->values))
+        return false;
+    *value = dequeue(q);
+    return true;
+}
+
+// Consumer side. Blocks in the kernel while the queue is empty.
+uint32_t mpmcQueuePop(mpmcQueue* q)
+{
+    fastWait(&q->values);
+    return dequeue(q);
+}
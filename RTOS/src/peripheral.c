@@ -26,6 +26,20 @@ void initTimer1()
     TIMER1_CTL_R |= TIMER_CTL_TAEN;                  // turn-on timer
 }
 
+// Free running timer that nothing resets, used to time the benchmarks
+void initTimer2()
+{
+    // Enable clocks
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;
+    _delay_cycles(3);
+
+    // Configure Timer 2
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER2_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER2_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR;     // configure for periodic mode (count up)
+    TIMER2_CTL_R |= TIMER_CTL_TAEN;                  // turn-on timer
+}
+
 void initLedPb()
 {
     enablePort(PORTA);
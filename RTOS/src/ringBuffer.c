@@ -0,0 +1,103 @@
+/*
+ * ringBuffer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Sarker Nadir Afridi Azmi
+ */
+
+#include "ringBuffer.h"
+#include "atomic.h"
+#include "syscalls.h"
+#include "kernel.h"
+
+// IPSR holds the number of the exception being handled, 0 in thread mode
+static uint32_t getIpsr()
+{
+    __asm(" MRS R0, IPSR");
+}
+
+// size is the number of uint32_t slots in data and has to be a power of 2
+bool ringBufferInit(ringBuffer* rb, uint32_t* data, uint32_t size, int8_t semaphore)
+{
+    if(size == 0 || (size & (size - 1)) != 0)
+        return false;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->waiting = 0;
+    rb->mask = size - 1;
+    rb->data = data;
+    rb->semaphore = semaphore;
+    return true;
+}
+
+// Producer side. Returns false if the buffer is full.
+// Can be called from a task or an ISR. An ISR can not make the post() syscall, so it
+// queues the post for the kernel instead.
+bool ringBufferPush(ringBuffer* rb, uint32_t value)
+{
+    uint32_t head = rb->head;
+    // head and tail are free running, so the difference is the number of used slots
+    if(head - rb->tail > rb->mask)
+        return false;
+    rb->data[head & rb->mask] = value;
+    // The value has to be visible before the consumer can see the new head
+    dataMemoryBarrier();
+    rb->head = head + 1;
+    // The new head has to be visible before looking at the waiting flag. Otherwise the
+    // consumer could check for an empty buffer after we read the flag and sleep forever.
+    dataMemoryBarrier();
+    if(atomicExchange(&rb->waiting, 0))
+    {
+        // If the kernel's queue of deferred requests is full the post is lost, so the
+        // flag is put back for the next push to try again
+        if(getIpsr() != 0)
+        {
+            if(!postFromIsr(rb->semaphore))
+                rb->waiting = 1;
+        }
+        else
+            post(rb->semaphore);
+    }
+    return true;
+}
+
+// Consumer side. Returns false if the buffer is empty.
+bool ringBufferTryPop(ringBuffer* rb, uint32_t* value)
+{
+    uint32_t tail = rb->tail;
+    if(rb->head == tail)
+        return false;
+    // Do not read the slot before seeing the head that published it
+    dataMemoryBarrier();
+    *value = rb->data[tail & rb->mask];
+    // The slot has to be read before it is handed back to the producer
+    dataMemoryBarrier();
+    rb->tail = tail + 1;
+    return true;
+}
+
+// Consumer side. Blocks on the semaphore while the buffer is empty.
+uint32_t ringBufferPop(ringBuffer* rb)
+{
+    uint32_t value;
+    while(!ringBufferTryPop(rb, &value))
+    {
+        // Announce that we are about to block, then check again. A producer that pushed
+        // before the announcement is seen by the second check, and a producer that pushes
+        // after it sees the flag and posts the semaphore.
+        atomicExchange(&rb->waiting, 1);
+        if(rb->head == rb->tail)
+            wait(rb->semaphore);
+        else
+            // A producer may have posted anyway. That only costs one spurious wake up
+            // the next time the buffer is empty.
+            atomicExchange(&rb->waiting, 0);
+    }
+    return value;
+}
+
+// Number of elements currently in the buffer
+uint32_t ringBufferCount(ringBuffer* rb)
+{
+    return rb->head - rb->tail;
+}
@@ -38,6 +38,195 @@ void post(int8_t semaphore)
     __asm(" SVC  #10");
 }
 
+// Same as wait(), but gives up after ticks ms. Returns WAIT_ACQUIRED if the semaphore
+// was acquired or WAIT_TIMEOUT if the time ran out first.
+uint8_t timedWait(int8_t semaphore, uint32_t ticks)
+{
+    __asm(" SVC #24");
+}
+
+// Creates a named semaphore and returns its handle, or -1 if the name is taken or
+// there is no room for another semaphore
+int8_t semCreate(const char name[], uint8_t count)
+{
+    __asm(" SVC #29");
+}
+
+// Returns the handle of the semaphore with matching name, or -1 if there is none
+int8_t semOpen(const char name[])
+{
+    __asm(" SVC #30");
+}
+
+// Deletes a semaphore. Fails if tasks are still waiting on it.
+bool semDelete(int8_t semaphore)
+{
+    __asm(" SVC #31");
+}
+
+// Returns the handle of the reader-writer lock with matching name, or -1 if there is none
+int8_t rwLockOpen(const char name[])
+{
+    __asm(" SVC #32");
+}
+
+// Blocks while a writer holds the lock or is waiting for it
+bool readLock(int8_t lock)
+{
+    __asm(" SVC #33");
+}
+
+bool readUnlock(int8_t lock)
+{
+    __asm(" SVC #34");
+}
+
+// Blocks until no reader or writer holds the lock
+bool writeLock(int8_t lock)
+{
+    __asm(" SVC #35");
+}
+
+bool writeUnlock(int8_t lock)
+{
+    __asm(" SVC #36");
+}
+
+// Returns the handle of the pipe with matching name, or -1 if there is none
+int8_t pipeOpen(const char name[])
+{
+    __asm(" SVC #44");
+}
+
+// Blocks until all the bytes are in the pipe. Returns the number of bytes written.
+uint32_t pipeWrite(int8_t pipe, const void* data, uint32_t bytes)
+{
+    __asm(" SVC #45");
+}
+
+// Blocks until the pipe holds its trigger level or bytes, whichever is smaller, or until
+// ticks ms have passed. Pass 0 to not block or WAIT_FOREVER to not time out.
+// Returns the number of bytes read.
+uint32_t pipeRead(int8_t pipe, void* data, uint32_t bytes, uint32_t ticks)
+{
+    __asm(" SVC #46");
+}
+
+int8_t selectWait(const selectItem items[], uint8_t count, uint32_t ticks)
+{
+    __asm(" SVC #47");
+}
+
+// Returns memory that only the calling task can access, rounded up to whole 1KiB blocks,
+// or 0 if there is not enough free SRAM. It is given back when the task is killed.
+void* allocateMemory(uint32_t bytes)
+{
+    __asm(" SVC #50");
+}
+
+// Returns false if p was not allocated by the calling task
+bool freeMemory(void* p)
+{
+    __asm(" SVC #51");
+}
+
+void heapStats(heapInfo* hi)
+{
+    __asm(" SVC #52");
+}
+
+void* shmOpen(const char name[])
+{
+    __asm(" SVC #57");
+}
+
+void memInfo(memoryInfo* mi)
+{
+    __asm(" SVC #58");
+}
+
+// Returns the handle of the pool with matching name, or -1 if there is none
+int8_t poolOpen(const char name[])
+{
+    __asm(" SVC #53");
+}
+
+// Returns a block from the pool. If the pool is empty, blocks until another task frees
+// a block or ticks ms pass, and returns 0 if the time runs out. Pass 0 to not block or
+// WAIT_FOREVER to not time out.
+void* poolAlloc(int8_t pool, uint32_t ticks)
+{
+    __asm(" SVC #54");
+}
+
+// Any task can give a block back, not just the one that allocated it. Returns false if
+// block is not a block of the pool.
+bool poolFree(int8_t pool, void* block)
+{
+    __asm(" SVC #55");
+}
+
+void pools(poolInfo* pi, uint8_t* piCount)
+{
+    __asm(" SVC #56");
+}
+
+// Returns the handle of the barrier with matching name, or -1 if there is none
+int8_t barrierOpen(const char name[])
+{
+    __asm(" SVC #48");
+}
+
+// Blocks until all the parties of the barrier have arrived. Returns BARRIER_SERIAL to the
+// last task to arrive, 0 to the others and -1 if the handle is not valid.
+int8_t barrierWait(int8_t barrier)
+{
+    __asm(" SVC #49");
+}
+
+// Returns the handle of the mutex with matching name, or -1 if there is none
+int8_t mutexOpen(const char name[])
+{
+    __asm(" SVC #37");
+}
+
+// Blocks until the mutex is free, unless the caller already holds it
+uint8_t mutexLock(int8_t mutex)
+{
+    __asm(" SVC #38");
+}
+
+// The mutex is only given up once it has been unlocked as many times as it was locked
+uint8_t mutexUnlock(int8_t mutex)
+{
+    __asm(" SVC #39");
+}
+
+// Returns the handle of the condition with matching name, or -1 if there is none
+int8_t condOpen(const char name[])
+{
+    __asm(" SVC #40");
+}
+
+// Gives up the mutex and blocks until the condition is signalled.
+// The mutex is held again when this returns.
+uint8_t condWait(int8_t condition, int8_t mutex)
+{
+    __asm(" SVC #41");
+}
+
+// Wakes up the highest priority task waiting on the condition
+uint8_t condSignal(int8_t condition)
+{
+    __asm(" SVC #42");
+}
+
+// Wakes up every task waiting on the condition
+uint8_t condBroadcast(int8_t condition)
+{
+    __asm(" SVC #43");
+}
+
 // Turns priority inheritance on or off
 // Will not be implemented
 void pi(bool on)
@@ -83,7 +272,7 @@ void resume(const char* name)
 }
 
 // Displays the inter-process (thread) communication state
-void ipcs(semaphoreInfo* semInfo)
+void ipcs(semaphoreInfo* semInfo, uint8_t* semInfoCount)
 {
     __asm(" SVC #17");
 }
@@ -93,3 +282,65 @@ void ps(taskInfo* ti, uint8_t* tiCount)
 {
     __asm(" SVC #18");
 }
+
+// Hands a buffer owned by the calling task over to the task with matching PID.
+// The caller can no longer touch the buffer once this returns true.
+bool sendBuffer(uint32_t pid, void* buffer)
+{
+    __asm(" SVC #19");
+}
+
+// Blocks until a buffer is handed to the calling task and returns its address
+void* receiveBuffer(uint32_t* size)
+{
+    __asm(" SVC #20");
+}
+
+// Sets flags in an event group. All the tasks waiting on the group whose wait is
+// now satisfied are woken up by the same call.
+uint32_t setEventFlags(uint8_t group, uint32_t flags)
+{
+    __asm(" SVC #21");
+}
+
+// Clears flags in an event group and returns the flags as they were before
+uint32_t clearEventFlags(uint8_t group, uint32_t flags)
+{
+    __asm(" SVC #22");
+}
+
+// Blocks until any or all (see EVENT_ options) of the flags are set in the event group.
+// Returns the flags of the group at the time the wait was satisfied.
+uint32_t waitEventFlags(uint8_t group, uint32_t flags, uint8_t options)
+{
+    __asm(" SVC #23");
+}
+
+// Direct-to-task notifications. Every task has a notification word in its tcb that other
+// tasks write directly, which is cheaper than a semaphore when exactly one task has to
+// be woken up.
+
+// Increments the notification word of the task, like posting a counting semaphore
+bool notifyGive(uint32_t pid)
+{
+    __asm(" SVC #25");
+}
+
+// ORs bits into the notification word of the task, like a light-weight event group
+bool notifySetBits(uint32_t pid, uint32_t bits)
+{
+    __asm(" SVC #26");
+}
+
+// Replaces the notification word of the task, like a single value mailbox
+bool notifyOverwrite(uint32_t pid, uint32_t value)
+{
+    __asm(" SVC #27");
+}
+
+// Blocks until the notification word of the calling task is non-zero and returns it.
+// The word is then cleared if clear is true or decremented otherwise.
+uint32_t notifyTake(bool clear)
+{
+    __asm(" SVC #28");
+}
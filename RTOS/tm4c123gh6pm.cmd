@@ -8,12 +8,27 @@
 
 --retain=g_pfnVectors
 
+/* SRAM layout. The kernel gets the bottom of the SRAM for its data and stack, the  */
+/* rest is the task arena that stacks, buffers, pools and allocations come from.   */
+/* The kernel reads the layout from the symbols defined below, so this is the only */
+/* place to change it. KERNEL_SRAM_SIZE has to be a multiple of 1KiB, the size of  */
+/* an MPU subregion.                                                                */
+#define SRAM_BASE           0x20000000
+#define SRAM_SIZE           0x00008000
+#define KERNEL_SRAM_SIZE    0x00002000
+
 MEMORY
 {
-    FLASH (RX) : origin = 0x00000000, length = 0x00040000
-    SRAM (RWX) : origin = 0x20000000, length = 0x00001400
+    FLASH (RX)  : origin = 0x00000000, length = 0x00040000
+    KERNEL (RWX) : origin = SRAM_BASE, length = KERNEL_SRAM_SIZE
+    TASKS (RW)  : origin = SRAM_BASE + KERNEL_SRAM_SIZE, length = SRAM_SIZE - KERNEL_SRAM_SIZE
 }
 
+__sram_start = SRAM_BASE;
+__sram_end = SRAM_BASE + SRAM_SIZE;
+__task_arena_start = SRAM_BASE + KERNEL_SRAM_SIZE;
+__task_arena_end = SRAM_BASE + SRAM_SIZE;
+
 /* The following command line options are set as part of the CCS project.    */
 /* If you are building using the command line, or for some reason want to    */
 /* define them here, you can uncomment and modify these lines as needed.     */
@@ -35,11 +50,15 @@ SECTIONS
     .pinit  :   > FLASH
     .init_array : > FLASH
 
-    .vtable :   > 0x20000000
-    .data   :   > SRAM
-    .bss    :   > SRAM
-    .sysmem :   > SRAM
-    .stack  :   > SRAM
+    .vtable :   > SRAM_BASE
+
+    GROUP       > KERNEL, RUN_START(__kernel_data_start), RUN_END(__kernel_data_end)
+    {
+        .data
+        .bss
+        .sysmem
+    }
+    .stack  :   > KERNEL, RUN_START(__kernel_stack_start), RUN_END(__kernel_stack_end)
 }
 
 __STACK_TOP = __stack + 512;